@@ -13,27 +13,74 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "header.h"
 #include "module/poseidon.h"
+#include "module/wavefront.h"
+#include "module/daemon.h"
+#include "module/watch.h"
+#include "module/terrain.h"
+#include "module/meshlet.h"
+#include "module/texture.h"
+#include "module/bvh.h"
+#include "module/selection.h"
+#include "module/validate.h"
 
-void ReadHeader(FILE *file, struct RVHeader *rvh)
+struct ConvertOptions
 {
-    fread(&rvh->Signature, sizeof(rvh->Signature), 1, file);
+    int        Meshlets;    //-meshlets
+    int        BVH;         //-bvh
+    int        Repair;      //-repair
+    const char *TextureRoot; //-textures <root>
+    struct SelectionFilter selection; //-selected, -selectedpoints, -faceflags <mask>, -mvalue <n>
+};
+
+static struct ConvertOptions options; //Set once from the command line, read only afterwards
+
+//=============================================================================
+// Every header field is a 32 bit int. A short read means the file ends right
+// there, whatever is left in the field must not be taken for a version.
+
+static int ReadHeaderField(FILE *file, int *field)
+{
+    if (fread(field, sizeof(int), 1, file) != 1)
+    {
+        fprintf(stderr, "Alert: File ends inside the header!\n");
+        return 1;
+    }
+    return 0;
+}
+
+//=============================================================================
+
+int ReadHeader(FILE *file, struct RVHeader *rvh)
+{
+    if (ReadHeaderField(file, &rvh->Signature))
+    {
+        return 1;
+    }
 
     switch (rvh->Signature) 
     {
         case SP3X_SIGNATURE:    
-            fread(&rvh->Unknown, sizeof(rvh->Unknown), 1, file);
+            if (ReadHeaderField(file, &rvh->Unknown))
+            {
+                return 1;
+            }
             if (rvh->Unknown != MAJOR_VERSION) //In fact, this makes no sense, since the program successfully read the signature...
             {
                 fprintf(stderr, "Alert: Wrong Major version! (0x%X instead of 0x1C).\n", rvh->Unknown);
-                exit(1);
+                return 1;
+            }
+            if (ReadHeaderField(file, &rvh->Unknown1))
+            {
+                return 1;
             }
-            fread(&rvh->Unknown1, sizeof(rvh->Unknown1), 1, file);
             if (rvh->Unknown1 != MINOR_VERSION) //In fact, this makes no sense, since the program successfully read the signature... 
             {
                 fprintf(stderr, "Alert: Wrong Minor version! (0x%X instead of 0x99).\n", rvh->Unknown1);
-                exit(1);
+                return 1;
             }
             #ifdef _DEBUG
             printf("Debug: Signature: 0x%X\n",   rvh->Signature);
@@ -47,7 +94,10 @@ void ReadHeader(FILE *file, struct RVHeader *rvh)
             #endif
             break;
         case ODOL_SIGNATURE:
-             fread(&rvh->Unknown, sizeof(rvh->Unknown), 1, file);
+             if (ReadHeaderField(file, &rvh->Unknown))
+             {
+                 return 1;
+             }
              switch (rvh->Unknown) 
              {
                 case VERSION_07:
@@ -56,73 +106,72 @@ void ReadHeader(FILE *file, struct RVHeader *rvh)
                      printf("Debug: Version: 0x%X\n", rvh->Unknown);
                      fprintf(stderr, "Alert: INEVITABLE!\n");
                      #endif
-                     exit(1);
-                     break;
+                     return 1;
                 case VERSION_40:
                      #ifdef _DEBUG
                      printf("Debug: Signature: 0x%X\n", rvh->Signature);
                      printf("Debug: Version: 0x%X\n", rvh->Unknown);
                      fprintf(stderr, "Alert: INEVITABLE!\n");
                      #endif
-                     exit(1);
-                     break;
+                     return 1;
                 case VERSION_43:
                      #ifdef _DEBUG
                      printf("Debug: Signature: 0x%X\n", rvh->Signature);
                      printf("Debug: Version: 0x%X\n", rvh->Unknown);
                      fprintf(stderr, "Alert: INEVITABLE!\n");
                      #endif
-                     exit(1);
-                     break;
+                     return 1;
                 case VERSION_47:
                      #ifdef _DEBUG
                      printf("Debug: Signature: 0x%X\n", rvh->Signature);
                      printf("Debug: Version: 0x%X\n", rvh->Unknown);
                      fprintf(stderr, "Alert: INEVITABLE!\n");
                      #endif
-                     exit(1);
-                     break;
+                     return 1;
                 case VERSION_48:
                      #ifdef _DEBUG
                      printf("Debug: Signature: 0x%X\n", rvh->Signature);
                      printf("Debug: Version: 0x%X\n", rvh->Unknown);
                      fprintf(stderr, "Alert: INEVITABLE!\n");
                      #endif
-                     exit(1);
-                     break;
+                     return 1;
                 case VERSION_49:
                      #ifdef _DEBUG
                      printf("Debug: Signature: 0x%X\n", rvh->Signature);
                      printf("Debug: Version: 0x%X\n", rvh->Unknown);
                      fprintf(stderr, "Alert: INEVITABLE!\n");
                      #endif
-                     exit(1);
-                     break;
+                     return 1;
                 case VERSION_50:
                      #ifdef _DEBUG
                      printf("Debug: Signature: 0x%X\n", rvh->Signature);
                      printf("Debug: Version: 0x%X\n", rvh->Unknown);
                      fprintf(stderr, "Alert: INEVITABLE!\n");
                      #endif
-                     exit(1);
-                     break;
+                     return 1;
                  default:
                      fprintf(stderr, "Alert: Unknown version! (0x%X).\n", rvh->Unknown);    
-                     exit(1);
+                     return 1;
              }
              break;
         case WVR1_SIGNATURE:
-            fread(&rvh->Unknown, sizeof(rvh->Unknown), 1, file);
-            if (rvh->Unknown != 128) //In fact, this makes no sense, since the program successfully read the signature...
+            if (ReadHeaderField(file, &rvh->Unknown))
+            {
+                return 1;
+            }
+            if (rvh->Unknown < 2 || rvh->Unknown > HEIGHTMAP_MAX_SIZE) //128 in 1WVR, bigger grids are split into tiles by -terrain
             {
-                fprintf(stderr, "Alert: Wrong Xsize value! (%X instead of 128).\n", rvh->Unknown);
-                exit(1);
+                fprintf(stderr, "Alert: Wrong Xsize value! (%d, 2..%d).\n", rvh->Unknown, HEIGHTMAP_MAX_SIZE);
+                return 1;
             }
-            fread(&rvh->Unknown1, sizeof(rvh->Unknown1), 1, file);
-            if (rvh->Unknown1 != 128) //In fact, this makes no sense, since the program successfully read the signature... 
+            if (ReadHeaderField(file, &rvh->Unknown1))
             {
-                fprintf(stderr, "Alert: Wrong Ysize value! (%X instead of 128).\n", rvh->Unknown1);
-                exit(1);
+                return 1;
+            }
+            if (rvh->Unknown1 < 2 || rvh->Unknown1 > HEIGHTMAP_MAX_SIZE)
+            {
+                fprintf(stderr, "Alert: Wrong Ysize value! (%d, 2..%d).\n", rvh->Unknown1, HEIGHTMAP_MAX_SIZE);
+                return 1;
             }
             #ifdef _DEBUG
             printf("Debug: Signature: 0x%X\n", rvh->Signature);
@@ -132,16 +181,23 @@ void ReadHeader(FILE *file, struct RVHeader *rvh)
             break;             
         default:
             fprintf(stderr, "Alert: Wrong signature! (0x%X).\n", rvh->Signature);    
-            exit(1);
+            return 1;
     }
+    return 0;
 }
 
 //=============================================================================
 
-void WriteOBJFile(FILE *f_out, struct P3D *p3d) 
+void WriteOBJFile(FILE *f_out, struct P3D *p3d, const char *mtllib) 
 {
     int i,j;
     int voffs = 1;
+    int uvoffs = 1; //Every face corner got its own "vt" line above
+
+    if (mtllib)
+    {
+        fprintf(f_out, "mtllib %s\n", mtllib);
+    }
 
     for (i = 0; i < p3d->data.nPoints; i++) 
     {
@@ -170,12 +226,16 @@ void WriteOBJFile(FILE *f_out, struct P3D *p3d)
     for (i = 0; i < p3d->data.nFaces; i++)
     {
         int facetype = (p3d->lodface[i].FaceType == 3) ? 3 : 4; //Skip fourth block if we don't need it. Check FaceType!!!  
+        if (mtllib && (i == 0 || strncmp(p3d->lodface[i].TextureName, p3d->lodface[i-1].TextureName, 31) != 0))
+        {
+            fprintf(f_out, "usemtl %.31s\n", p3d->lodface[i].TextureName);
+        }
         fprintf(f_out, "f");
         for (j = 0; j < facetype; j++) 
         {
             fprintf(f_out, " %d/%d/%d", 
                 p3d->lodface[i].p3dvertextable[j].PointsIndex+voffs, 
-                p3d->lodface[i].p3dvertextable[j].PointsIndex+voffs, 
+                uvoffs++, 
                 p3d->lodface[i].p3dvertextable[j].NormalsIndex+voffs
             );
         }
@@ -185,6 +245,17 @@ void WriteOBJFile(FILE *f_out, struct P3D *p3d)
 
 //=============================================================================
 
+int IsOBJFile(const char *path)
+{
+    const char *ext = strrchr(path, '.');
+
+    return ext && (ext[1] == 'o' || ext[1] == 'O') && 
+                  (ext[2] == 'b' || ext[2] == 'B') && 
+                  (ext[3] == 'j' || ext[3] == 'J') && ext[4] == '\0';
+}
+
+//=============================================================================
+
 void InitData(struct P3D *p3d, struct WVR *wvr)
 {
     p3d->point = NULL;
@@ -194,7 +265,10 @@ void InitData(struct P3D *p3d, struct WVR *wvr)
     p3d->supply.TinyBools = NULL;
     p3d->supply.Indexes = NULL;
 
+    wvr->texture.Elevations = NULL;
+    wvr->texture.TextureIndex = NULL;
     wvr->model = NULL;
+    wvr->nModels = 0;
     wvr->net.subnet = NULL;
 }
 
@@ -209,76 +283,426 @@ void UnloadData(struct P3D *p3d, struct WVR *wvr)
     if (p3d->supply.TinyBools) { free(p3d->supply.TinyBools); p3d->supply.TinyBools = NULL; }
     if (p3d->supply.Indexes)   { free(p3d->supply.Indexes);   p3d->supply.Indexes = NULL; }
 
+    if (wvr->texture.Elevations)   { free(wvr->texture.Elevations);   wvr->texture.Elevations = NULL; }
+    if (wvr->texture.TextureIndex) { free(wvr->texture.TextureIndex); wvr->texture.TextureIndex = NULL; }
+
     if (wvr->model)      { free(wvr->model);      wvr->model = NULL; }
     if (wvr->net.subnet) { free(wvr->net.subnet); wvr->net.subnet = NULL; }
 }
 
 //=============================================================================
 
-int main(int argc, char *argv[])   
+int GetSidecarPath(char *path, size_t size, const char *output_file, const char *ext)
 {
-    const char *input_file;
-    const char *output_file;
+    const char *dot = strrchr(output_file, '.');
+    size_t     length = strlen(output_file);
 
-    FILE *f_in;
-    FILE *f_out;
-    
-    struct RVHeader rvh;
-    
-    struct P3D p3d;
-    struct WVR wvr;
-    
-    input_file = argv[1];
-    output_file = "output.obj";
+    if (dot && !strpbrk(dot, "/\\")) length = dot - output_file; //"output.obj" -> "output.mlt"
+    if (length + strlen(ext) >= size)
+    {
+        fprintf(stderr, "Alert: Path <%s> is too long!\n", output_file);
+        return 1;
+    }
+    memcpy(path, output_file, length);
+    strcpy(path + length, ext);
+    return 0;
+}
+
+//=============================================================================
+
+const char *GetFileName(const char *path)
+{
+    const char *name = path;
+    const char *p;
 
-    if (argc < 2) 
+    for (p = path; *p; p++)
     {
-        printf("Info: Usage: %s <input_file>\n", argv[0]);
+        if (*p == '/' || *p == '\\') name = p + 1;
+    }
+    return name;
+}
+
+//=============================================================================
+// Directory part of "path" including the trailing separator, "" if none.
+
+int GetOutputDir(char *outdir, size_t size, const char *path)
+{
+    size_t length = GetFileName(path) - path;
+
+    if (length >= size)
+    {
+        fprintf(stderr, "Alert: Path <%s> is too long!\n", path);
         return 1;
     }
+    memcpy(outdir, path, length);
+    outdir[length] = '\0';
+    return 0;
+}
 
-    f_in = fopen(input_file, "rb");
-    if (!f_in) 
+//=============================================================================
+
+int DecodeModelTextures(struct P3D *p3d, const char *output_file)
+{
+    char outdir[512];
+    char (*names)[32];
+    int  i;
+    int  result;
+
+    if (GetOutputDir(outdir, sizeof(outdir), output_file)) //Images go next to the model
     {
-        fprintf(stderr, "Alert: Error loading <%s!\n", argv[1]);
         return 1;
     }
 
-    f_out = fopen(output_file, "w");
-    if (!f_out) 
+    names = (char (*)[32])malloc((p3d->data.nFaces ? p3d->data.nFaces : 1) * 32);
+    if (!names)
     {
-        fprintf(stderr, "Alert: Error loading output file!\n");
-        fclose(f_in);
         return 1;
     }
+    for (i = 0; i < p3d->data.nFaces; i++)
+    {
+        memcpy(names[i], p3d->lodface[i].TextureName, 32);
+    }
+    result = DecodeTextures(names, p3d->data.nFaces, options.TextureRoot, outdir);
+
+    free(names);
+    return result;
+}
+
+//=============================================================================
+
+int WriteSidecar(const char *output_file, const char *ext, int (*writer)(FILE *file, struct P3D *p3d), struct P3D *p3d)
+{
+    char path[512];
+    FILE *file;
+    int  result;
+
+    if (GetSidecarPath(path, sizeof(path), output_file, ext))
+    {
+        return 1;
+    }
+
+    file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Alert: Error loading <%s>!\n", path);
+        return 1;
+    }
+    result = writer(file, p3d);
+    fclose(file);
+    return result;
+}
+
+//=============================================================================
+
+int WriteP3DOutputs(FILE *f_out, struct P3D *p3d, int isobj, const char *output_file)
+{
+    int result = 0;
+
+    if (isobj)
+    {
+        WriteSP3XFile(f_out, p3d);
+    }
+    else if (options.TextureRoot)
+    {
+        char mtllib[512];
+
+        if (GetSidecarPath(mtllib, sizeof(mtllib), output_file, ".mtl"))
+        {
+            return 1;
+        }
+        WriteOBJFile(f_out, p3d, GetFileName(mtllib));
+        result = WriteSidecar(output_file, ".mtl", WriteMTLFile, p3d);
+        if (!result)
+        {
+            result = DecodeModelTextures(p3d, output_file);
+        }
+    }
+    else
+    {
+        WriteOBJFile(f_out, p3d, NULL);
+    }
+
+    if (options.Meshlets && !result)
+    {
+        result = WriteSidecar(output_file, ".mlt", WriteMeshletFile, p3d);
+    }
+    if (options.BVH && !result)
+    {
+        result = WriteSidecar(output_file, ".bvh", WriteBVHFile, p3d);
+    }
+    return result;
+}
+
+//=============================================================================
+// Everything WriteP3DOutputs puts next to the output, a daemon cache hit
+// needs all of it. The decoded images are checked by the texture registry.
+
+int CheckSidecars(int isobj, const char *output_file)
+{
+    static const char *ext[3] = { ".mtl", ".mlt", ".bvh" };
+    int               used[3];
+    char              path[512];
+    struct stat       st;
+    int               i;
+
+    if (isobj) //SP3X output has none
+    {
+        return 0;
+    }
+    used[0] = (options.TextureRoot != NULL);
+    used[1] = options.Meshlets;
+    used[2] = options.BVH;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (used[i] && (GetSidecarPath(path, sizeof(path), output_file, ext[i]) || stat(path, &st) != 0))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//=============================================================================
+
+int ConvertStream(FILE *f_in, int isobj, FILE *f_out, const char *output_file)
+{
+    struct RVHeader rvh;
+    
+    struct P3D p3d;
+    struct WVR wvr;
+    
+    int result = 0;
 
     InitData(&p3d, &wvr);
-    ReadHeader(f_in, &rvh);
 
-    if (rvh.Signature != WVR1_SIGNATURE)
+    if (isobj)
     {
-        ReadP3DData(f_in, &p3d);
+        result = ReadOBJFile(f_in, &p3d);
+    }
+    else
+    {
+        if (ReadHeader(f_in, &rvh))
+        {
+            return 1;
+        }
+
+        if (rvh.Signature == WVR1_SIGNATURE)
+        {
+            result = ReadWVRTexture(f_in, &wvr, &rvh);
+            if (!result)
+            {
+                result = ReadWVRModels(f_in, &wvr);
+            }
+            if (!result)
+            {
+                result = ReadWVRNet(f_in, &wvr);
+            }
+
+            UnloadData(&p3d, &wvr);
+            return result;
+        }
+
+        if (ReadP3DData(f_in, &p3d) || ValidateP3DData(f_in, &p3d, &rvh))
+        {
+            fprintf(stderr, "Alert: Model is broken, nothing converted!\n");
+            return 1;
+        }
         ReadP3DPoints(f_in, &p3d, &rvh);
         ReadP3DFaceNormals(f_in, &p3d);
         ReadP3DLodFaces(f_in, &p3d, &rvh);
         
         if (rvh.Signature == SP3D_SIGNATURE || rvh.Signature == SP3X_SIGNATURE)
         {
-            ReadP3DSupplement(f_in, &p3d, &rvh);
+            result = ReadP3DSupplement(f_in, &p3d, &rvh);
+        }
+        if (!result)
+        {
+            result = ValidateP3DFaces(&p3d, options.Repair);
         }
-        
-        WriteOBJFile(f_out, &p3d);
     }
-    else
+
+    if (!result)
+    {
+        result = ExtractSelection(&p3d, &options.selection);
+    }
+    if (!result)
     {
-        ReadWVRTexture(f_in, &wvr);
-        ReadWVRModels(f_in, &wvr);
-        ReadWVRNet(f_in, &wvr);
+        result = WriteP3DOutputs(f_out, &p3d, isobj, output_file);
     }
 
     UnloadData(&p3d, &wvr);
+    return result;
+}
+
+//=============================================================================
+
+int ConvertTerrain(const char *input_file, const char *prefix)
+{
+    struct RVHeader rvh;
+    struct P3D      p3d;
+    struct WVR      wvr;
+    FILE            *f_in;
+    int             result = 1;
+
+    f_in = fopen(input_file, "rb");
+    if (!f_in) 
+    {
+        fprintf(stderr, "Alert: Error loading <%s!\n", input_file);
+        return 1;
+    }
+
+    InitData(&p3d, &wvr);
+    if (!ReadHeader(f_in, &rvh))
+    {
+        if (rvh.Signature == WVR1_SIGNATURE)
+        {
+            result = ReadWVRTexture(f_in, &wvr, &rvh);
+            if (!result)
+            {
+                result = ExportWVRTerrain(&wvr, prefix, options.TextureRoot != NULL);
+            }
+            if (!result && options.TextureRoot)
+            {
+                char outdir[512];
+                char names[256][32];
+
+                result = GetOutputDir(outdir, sizeof(outdir), prefix);
+                if (!result)
+                {
+                    GetTerrainTextures(&wvr, names); //Only what the tiles use
+                    result = DecodeTextures(names, 256, options.TextureRoot, outdir);
+                }
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Alert: <%s> is not a WVR map!\n", input_file);
+        }
+    }
+
+    UnloadData(&p3d, &wvr);
+    fclose(f_in);
+    return result;
+}
+
+//=============================================================================
+
+int main(int argc, char *argv[])   
+{
+    const char *input_file;
+    const char *output_file;
+
+    FILE *f_in;
+    FILE *f_out;
+    
+    int arg;
+    int result;
+
+    for (arg = 1; arg < argc; arg++) //Stage options come first, they apply to every mode
+    {
+        if (strcmp(argv[arg], "-meshlets") == 0)
+        {
+            options.Meshlets = 1;
+        }
+        else if (strcmp(argv[arg], "-bvh") == 0)
+        {
+            options.BVH = 1;
+        }
+        else if (strcmp(argv[arg], "-repair") == 0)
+        {
+            options.Repair = 1;
+        }
+        else if (strcmp(argv[arg], "-selected") == 0)
+        {
+            options.selection.Selected = 1;
+        }
+        else if (strcmp(argv[arg], "-selectedpoints") == 0)
+        {
+            options.selection.SelectedPoints = 1;
+        }
+        else if (strcmp(argv[arg], "-faceflags") == 0 && arg + 1 < argc)
+        {
+            options.selection.FaceFlags = strtoul(argv[++arg], NULL, 0); //"0x10" or "16"
+        }
+        else if (strcmp(argv[arg], "-mvalue") == 0 && arg + 1 < argc)
+        {
+            char *end;
+            long value = strtol(argv[++arg], &end, 0);
+
+            if (end == argv[arg] || *end != '\0' || value < 0 || value > 127) //7 bits of FaceFlags
+            {
+                fprintf(stderr, "Alert: Wrong -mvalue <%s>, has to be 0..127!\n", argv[arg]);
+                return 1;
+            }
+            options.selection.UseMValue = 1;
+            options.selection.MValue = (int)value;
+        }
+        else if (strcmp(argv[arg], "-textures") == 0 && arg + 1 < argc)
+        {
+            options.TextureRoot = argv[++arg];
+            InitTextureCache();
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (arg >= argc) 
+    {
+        printf("Info: Usage: %s [options] <input_file>\n", argv[0]);
+        printf("Info:        %s [options] -daemon [socket_path]\n", argv[0]);
+        printf("Info:        %s [options] -watch <directory>\n", argv[0]);
+        printf("Info:        %s [options] -terrain <map.wrp> [prefix]\n", argv[0]);
+        printf("Info: .p3d/.wrp input is converted to output.obj, .obj input back to output.p3d (SP3X)\n");
+        printf("Info: Options: -meshlets         write clusters to <output>.mlt\n");
+        printf("Info:          -bvh              write a ray/picking hierarchy and model bounds to <output>.bvh\n");
+        printf("Info:          -repair           drop broken faces instead of rejecting the model\n");
+        printf("Info:          -selected         export only the faces selected in SS3D\n");
+        printf("Info:          -selectedpoints   export only faces whose points are all selected in SS3D\n");
+        printf("Info:          -faceflags <mask> export only faces with any of these FaceFlags bits\n");
+        printf("Info:          -mvalue <n>       export only faces with this user mark value (0..127)\n");
+        printf("Info:          -textures <root>  decode referenced .pac/.paa below <root> to .tga, write <output>.mtl\n");
+        return 1;
+    }
+
+    if (strcmp(argv[arg], "-daemon") == 0)
+    {
+        return RunDaemon((argc > arg + 1) ? argv[arg + 1] : NULL, ConvertStream, CheckSidecars);
+    }
+
+    if (strcmp(argv[arg], "-watch") == 0)
+    {
+        return RunWatch((argc > arg + 1) ? argv[arg + 1] : ".", ConvertStream);
+    }
+
+    if (strcmp(argv[arg], "-terrain") == 0 && argc > arg + 1)
+    {
+        return ConvertTerrain(argv[arg + 1], (argc > arg + 2) ? argv[arg + 2] : "terrain");
+    }
+
+    input_file = argv[arg];
+    output_file = IsOBJFile(input_file) ? "output.p3d" : "output.obj";
+
+    f_in = fopen(input_file, "rb");
+    if (!f_in) 
+    {
+        fprintf(stderr, "Alert: Error loading <%s!\n", input_file);
+        return 1;
+    }
+
+    f_out = fopen(output_file, IsOBJFile(input_file) ? "wb" : "w");
+    if (!f_out) 
+    {
+        fprintf(stderr, "Alert: Error loading output file!\n");
+        fclose(f_in);
+        return 1;
+    }
+
+    result = ConvertStream(f_in, IsOBJFile(input_file), f_out, output_file);
     
     fclose(f_in);
     fclose(f_out);
-    return 0;
-}
\ No newline at end of file
+    return result;
+}
@@ -0,0 +1,557 @@
+//=============================================================================
+//
+//  Module:         BVH - precomputed ray/picking hierarchy for converted models
+//
+//  Author:         GameSpy
+//
+//  Date:           Started 19.10.2026
+//
+//=============================================================================
+// Faces are triangulated and split with a binned SAH. The top of the tree is
+// built on the calling thread until the ranges are small enough, every range
+// left over is built on its own thread into its own node array. The arrays
+// are then stitched together depth first, so a subtree is always contiguous.
+//=============================================================================
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "bvh.h"
+#include "thread.h"
+#include "common.h"
+
+struct BVHTask
+{
+    int            First;      //Range in BVHBuild.order
+    int            Count;
+    int            Depth;
+    struct BVHNode *node;
+    int            nNodes, capNodes;
+    int            failed;
+};
+
+//=============================================================================
+
+struct BVHBuild
+{
+    struct P3D         *p3d;
+    struct BVHTriangle *tri;
+    struct P3DTriplet  *centroid;
+    int                *order;
+    int                nTris;
+    int                TaskSize;
+    struct BVHNode     *top;       //Tree above the tasks, a task is a node with Count -1
+    int                nTop, capTop;
+    struct BVHTask     *task;
+    int                nTasks, capTasks;
+    int                failed;
+};
+
+//=============================================================================
+
+static void ClearBounds(struct P3DTriplet *bmin, struct P3DTriplet *bmax)
+{
+    int k;
+
+    for (k = 0; k < 3; k++)
+    {
+        bmin->XYZ[k] = 3.0e38f;
+        bmax->XYZ[k] = -3.0e38f;
+    }
+}
+
+//=============================================================================
+
+static void GrowBounds(struct P3DTriplet *bmin, struct P3DTriplet *bmax, const struct P3DTriplet *p)
+{
+    int k;
+
+    for (k = 0; k < 3; k++)
+    {
+        if (p->XYZ[k] < bmin->XYZ[k]) bmin->XYZ[k] = p->XYZ[k];
+        if (p->XYZ[k] > bmax->XYZ[k]) bmax->XYZ[k] = p->XYZ[k];
+    }
+}
+
+//=============================================================================
+
+static float GetArea(const struct P3DTriplet *bmin, const struct P3DTriplet *bmax)
+{
+    float dx = bmax->XYZ[0] - bmin->XYZ[0];
+    float dy = bmax->XYZ[1] - bmin->XYZ[1];
+    float dz = bmax->XYZ[2] - bmin->XYZ[2];
+
+    if (dx < 0.0f || dy < 0.0f || dz < 0.0f) //Empty
+    {
+        return 0.0f;
+    }
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+//=============================================================================
+
+static int Triangulate(struct BVHBuild *build)
+{
+    struct P3D *p3d = build->p3d;
+    int        i,k,v,n;
+
+    build->nTris = GetTriangleCount(p3d);
+
+    build->tri = (struct BVHTriangle *)malloc((build->nTris + 1) * sizeof(struct BVHTriangle));
+    build->centroid = (struct P3DTriplet *)malloc((build->nTris + 1) * sizeof(struct P3DTriplet));
+    build->order = (int *)malloc((build->nTris + 1) * sizeof(int));
+    if (!build->tri || !build->centroid || !build->order)
+    {
+        return 1;
+    }
+
+    n = 0;
+    for (i = 0; i < p3d->data.nFaces; i++)
+    {
+        int tri[2][3];
+        int count = GetFaceTriangles(&p3d->lodface[i], tri);
+
+        for (k = 0; k < count; k++)
+        {
+            for (v = 0; v < 3; v++)
+            {
+                if (tri[k][v] < 0 || tri[k][v] >= p3d->data.nPoints)
+                {
+                    fprintf(stderr, "Alert: Face %d points outside the point table!\n", i);
+                    return 1;
+                }
+                build->tri[n].Vertex[v] = p3d->point[tri[k][v]].position;
+            }
+            build->tri[n].Face = i;
+            for (v = 0; v < 3; v++)
+            {
+                build->centroid[n].XYZ[v] = (build->tri[n].Vertex[0].XYZ[v] + build->tri[n].Vertex[1].XYZ[v] + build->tri[n].Vertex[2].XYZ[v]) / 3.0f;
+            }
+            build->order[n] = n;
+            n++;
+        }
+    }
+    return 0;
+}
+
+//=============================================================================
+// Fills in the bounds of the range. Returns the split position inside the
+// range, or 0 if the range should stay a leaf.
+
+static int SplitRange(struct BVHBuild *build, int first, int count, int depth, struct BVHNode *node)
+{
+    struct P3DTriplet cmin, cmax;
+    struct P3DTriplet binMin[3][BVH_BINS], binMax[3][BVH_BINS];
+    int               binCount[3][BVH_BINS];
+    float             rightArea[BVH_BINS];
+    float             scale[3];
+    float             bestCost;
+    int               bestAxis = -1, bestBin = 0;
+    int               i,k,b,v;
+    int               *order = build->order;
+
+    ClearBounds(&node->Min, &node->Max);
+    ClearBounds(&cmin, &cmax);
+    for (i = first; i < first + count; i++)
+    {
+        struct BVHTriangle *t = &build->tri[order[i]];
+        for (v = 0; v < 3; v++) GrowBounds(&node->Min, &node->Max, &t->Vertex[v]);
+        GrowBounds(&cmin, &cmax, &build->centroid[order[i]]);
+    }
+
+    if (count <= BVH_LEAF_SIZE || depth >= BVH_MAX_DEPTH)
+    {
+        return 0;
+    }
+
+    for (k = 0; k < 3; k++)
+    {
+        float extent = cmax.XYZ[k] - cmin.XYZ[k];
+
+        scale[k] = (extent > 0.0f) ? BVH_BINS * 0.9999f / extent : 0.0f;
+        for (b = 0; b < BVH_BINS; b++)
+        {
+            binCount[k][b] = 0;
+            ClearBounds(&binMin[k][b], &binMax[k][b]);
+        }
+    }
+    for (i = first; i < first + count; i++)
+    {
+        struct BVHTriangle *t = &build->tri[order[i]];
+
+        for (k = 0; k < 3; k++)
+        {
+            if (scale[k] == 0.0f) continue;
+            b = (int)((build->centroid[order[i]].XYZ[k] - cmin.XYZ[k]) * scale[k]);
+            if (b >= BVH_BINS) b = BVH_BINS - 1;
+            binCount[k][b]++;
+            for (v = 0; v < 3; v++) GrowBounds(&binMin[k][b], &binMax[k][b], &t->Vertex[v]);
+        }
+    }
+
+    //Cost of a leaf is one intersection per triangle, a split pays one traversal step
+    bestCost = (float)count;
+    for (k = 0; k < 3; k++)
+    {
+        struct P3DTriplet lmin, lmax, rmin, rmax;
+        float             parentArea = GetArea(&node->Min, &node->Max);
+        int               nLeft = 0;
+
+        if (scale[k] == 0.0f || parentArea <= 0.0f) continue;
+
+        ClearBounds(&rmin, &rmax);
+        for (b = BVH_BINS - 1; b > 0; b--)
+        {
+            if (binCount[k][b])
+            {
+                GrowBounds(&rmin, &rmax, &binMin[k][b]);
+                GrowBounds(&rmin, &rmax, &binMax[k][b]);
+            }
+            rightArea[b] = GetArea(&rmin, &rmax);
+        }
+        ClearBounds(&lmin, &lmax);
+        for (b = 0; b < BVH_BINS - 1; b++)
+        {
+            float cost;
+
+            if (binCount[k][b])
+            {
+                nLeft += binCount[k][b];
+                GrowBounds(&lmin, &lmax, &binMin[k][b]);
+                GrowBounds(&lmin, &lmax, &binMax[k][b]);
+            }
+            if (nLeft == 0 || nLeft == count) continue;
+
+            cost = 1.0f + (GetArea(&lmin, &lmax) * nLeft + rightArea[b + 1] * (count - nLeft)) / parentArea;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = k;
+                bestBin = b;
+            }
+        }
+    }
+
+    if (bestAxis < 0)
+    {
+        if (count <= BVH_MAX_LEAF || (scale[0] == 0.0f && scale[1] == 0.0f && scale[2] == 0.0f))
+        {
+            return 0; //Cheaper as a leaf, or all centroids sit on one spot
+        }
+        for (k = 0; k < 3; k++) //Too big for a leaf, fall back to splitting the widest axis in the middle
+        {
+            if (bestAxis < 0 || cmax.XYZ[k] - cmin.XYZ[k] > cmax.XYZ[bestAxis] - cmin.XYZ[bestAxis]) bestAxis = k;
+        }
+        bestBin = BVH_BINS / 2 - 1;
+    }
+
+    {
+        int left = first;
+        int right = first + count - 1;
+
+        while (left <= right)
+        {
+            b = (int)((build->centroid[order[left]].XYZ[bestAxis] - cmin.XYZ[bestAxis]) * scale[bestAxis]);
+            if (b >= BVH_BINS) b = BVH_BINS - 1;
+            if (b <= bestBin)
+            {
+                left++;
+            }
+            else
+            {
+                int swap = order[left];
+                order[left] = order[right];
+                order[right--] = swap;
+            }
+        }
+        return (left > first && left < first + count) ? left : 0;
+    }
+}
+
+//=============================================================================
+
+static int BuildNode(struct BVHBuild *build, struct BVHTask *task, int first, int count, int depth)
+{
+    struct BVHNode node;
+    int            split = SplitRange(build, first, count, depth, &node);
+    int            index;
+
+    task->node = (struct BVHNode *)GrowArray(task->node, &task->capNodes, task->nNodes + 1, sizeof(struct BVHNode));
+    if (!task->node)
+    {
+        task->failed = 1;
+        return -1;
+    }
+    index = task->nNodes++;
+
+    if (!split)
+    {
+        node.First = first;
+        node.Count = count;
+        task->node[index] = node;
+        return index;
+    }
+
+    node.Count = 0;
+    task->node[index] = node;
+    BuildNode(build, task, first, split - first, depth + 1);
+    if (task->failed)
+    {
+        return -1;
+    }
+    task->node[index].First = task->nNodes;
+    BuildNode(build, task, split, first + count - split, depth + 1);
+    return index;
+}
+
+//=============================================================================
+
+static void BuildTask(void *context, int index)
+{
+    struct BVHBuild *build = (struct BVHBuild *)context;
+    struct BVHTask  *task = &build->task[index];
+
+    BuildNode(build, task, task->First, task->Count, task->Depth);
+}
+
+//=============================================================================
+// Same as BuildNode, but ranges below TaskSize become tasks for later.
+
+static int BuildTop(struct BVHBuild *build, int first, int count, int depth)
+{
+    struct BVHNode node;
+    int            split;
+    int            index;
+
+    build->top = (struct BVHNode *)GrowArray(build->top, &build->capTop, build->nTop + 1, sizeof(struct BVHNode));
+    if (!build->top)
+    {
+        build->failed = 1;
+        return -1;
+    }
+    index = build->nTop++;
+
+    if (count <= build->TaskSize || depth >= BVH_MAX_DEPTH / 4)
+    {
+        build->task = (struct BVHTask *)GrowArray(build->task, &build->capTasks, build->nTasks + 1, sizeof(struct BVHTask));
+        if (!build->task)
+        {
+            build->failed = 1;
+            return -1;
+        }
+        memset(&build->task[build->nTasks], 0, sizeof(struct BVHTask));
+        build->task[build->nTasks].First = first;
+        build->task[build->nTasks].Count = count;
+        build->task[build->nTasks].Depth = depth;
+        build->top[index].First = build->nTasks++;
+        build->top[index].Count = -1;
+        return index;
+    }
+
+    split = SplitRange(build, first, count, depth, &node);
+    if (!split)
+    {
+        node.First = first;
+        node.Count = count;
+        build->top[index] = node;
+        return index;
+    }
+
+    node.Count = 0;
+    build->top[index] = node;
+    BuildTop(build, first, split - first, depth + 1);
+    if (build->failed)
+    {
+        return -1;
+    }
+    build->top[index].First = build->nTop;
+    BuildTop(build, split, first + count - split, depth + 1);
+    return index;
+}
+
+//=============================================================================
+// Depth first copy of the top tree, task arrays are spliced in where their
+// placeholder was. Returns the number of nodes written.
+
+static int FlattenNode(struct BVHBuild *build, int top, struct BVHNode *out, int n)
+{
+    struct BVHNode node = build->top[top];
+    int            i;
+
+    if (node.Count < 0)
+    {
+        struct BVHTask *task = &build->task[node.First];
+
+        for (i = 0; i < task->nNodes; i++)
+        {
+            out[n + i] = task->node[i];
+            if (out[n + i].Count == 0) out[n + i].First += n;
+        }
+        return n + task->nNodes;
+    }
+
+    out[n] = node;
+    if (node.Count > 0)
+    {
+        return n + 1;
+    }
+    i = n;
+    n = FlattenNode(build, top + 1, out, n + 1);
+    out[i].First = n;
+    return FlattenNode(build, node.First, out, n);
+}
+
+//=============================================================================
+// Ritter's sphere: start from two far apart points, grow to take in the rest.
+
+static void GetBoundingSphere(struct P3D *p3d, struct P3DTriplet *center, float *radius)
+{
+    struct P3DTriplet *a, *b;
+    float             best, d;
+    int               i,k;
+
+    if (p3d->data.nPoints <= 0)
+    {
+        memset(center, 0, sizeof(*center));
+        *radius = 0.0f;
+        return;
+    }
+
+    a = &p3d->point[0].position;
+    for (k = 0; k < 2; k++) //Farthest from point 0, then farthest from that one
+    {
+        b = a;
+        best = -1.0f;
+        for (i = 0; i < p3d->data.nPoints; i++)
+        {
+            struct P3DTriplet *p = &p3d->point[i].position;
+            d = (p->XYZ[0] - a->XYZ[0]) * (p->XYZ[0] - a->XYZ[0]) +
+                (p->XYZ[1] - a->XYZ[1]) * (p->XYZ[1] - a->XYZ[1]) +
+                (p->XYZ[2] - a->XYZ[2]) * (p->XYZ[2] - a->XYZ[2]);
+            if (d > best)
+            {
+                best = d;
+                b = p;
+            }
+        }
+        if (k == 0) a = b;
+    }
+
+    for (k = 0; k < 3; k++) center->XYZ[k] = (a->XYZ[k] + b->XYZ[k]) * 0.5f;
+    *radius = (float)sqrt(best) * 0.5f;
+
+    for (i = 0; i < p3d->data.nPoints; i++)
+    {
+        struct P3DTriplet *p = &p3d->point[i].position;
+        float             dist;
+
+        d = (p->XYZ[0] - center->XYZ[0]) * (p->XYZ[0] - center->XYZ[0]) +
+            (p->XYZ[1] - center->XYZ[1]) * (p->XYZ[1] - center->XYZ[1]) +
+            (p->XYZ[2] - center->XYZ[2]) * (p->XYZ[2] - center->XYZ[2]);
+        if (d <= *radius * *radius) continue;
+
+        dist = (float)sqrt(d);
+        for (k = 0; k < 3; k++) //Move the center half way towards the point
+        {
+            center->XYZ[k] += (p->XYZ[k] - center->XYZ[k]) * (dist - *radius) * 0.5f / dist;
+        }
+        *radius = (*radius + dist) * 0.5f;
+    }
+    *radius *= 1.0001f; //Float slack, every point must test inside
+}
+
+//=============================================================================
+
+int WriteBVHFile(FILE *file, struct P3D *p3d)
+{
+    struct BVHBuild  build;
+    struct BVHHeader header;
+    struct BVHNode   *node = NULL;
+    int              i;
+
+    memset(&build, 0, sizeof(build));
+    memset(&header, 0, sizeof(header));
+    build.p3d = p3d;
+
+    if (Triangulate(&build))
+    {
+        build.failed = 1;
+    }
+    else if (build.nTris > 0)
+    {
+        build.TaskSize = build.nTris / (GetThreadCount() * 4);
+        if (build.TaskSize < BVH_TASK_SIZE) build.TaskSize = BVH_TASK_SIZE;
+
+        BuildTop(&build, 0, build.nTris, 0);
+        if (!build.failed)
+        {
+            ParallelFor(build.nTasks, BuildTask, &build);
+        }
+        for (i = 0; i < build.nTasks; i++)
+        {
+            header.nNodes += build.task[i].nNodes;
+            build.failed |= build.task[i].failed;
+        }
+        for (i = 0; i < build.nTop; i++)
+        {
+            if (build.top[i].Count >= 0) header.nNodes++;
+        }
+        node = (struct BVHNode *)malloc(header.nNodes * sizeof(struct BVHNode));
+        if (!node)
+        {
+            build.failed = 1;
+        }
+        if (!build.failed)
+        {
+            FlattenNode(&build, 0, node, 0);
+        }
+    }
+
+    if (!build.failed)
+    {
+        header.Signature = BVH_SIGNATURE;
+        header.nTriangles = build.nTris;
+        ClearBounds(&header.Min, &header.Max);
+        for (i = 0; i < p3d->data.nPoints; i++)
+        {
+            GrowBounds(&header.Min, &header.Max, &p3d->point[i].position);
+        }
+        if (p3d->data.nPoints <= 0)
+        {
+            memset(&header.Min, 0, sizeof(header.Min));
+            memset(&header.Max, 0, sizeof(header.Max));
+        }
+        GetBoundingSphere(p3d, &header.Center, &header.Radius);
+
+        fwrite(&header, sizeof(header), 1, file);
+        if (header.nNodes)
+        {
+            fwrite(node, sizeof(struct BVHNode), header.nNodes, file);
+        }
+        for (i = 0; i < build.nTris; i++)
+        {
+            fwrite(&build.tri[build.order[i]], sizeof(struct BVHTriangle), 1, file);
+        }
+
+        #ifdef _DEBUG
+        printf("Debug: BVH: %d nodes, %d triangles, %d tasks\n", header.nNodes, header.nTriangles, build.nTasks);
+        #endif
+    }
+    else
+    {
+        fprintf(stderr, "Alert: Error building BVH!\n");
+    }
+
+    for (i = 0; build.task && i < build.nTasks; i++)
+    {
+        free(build.task[i].node);
+    }
+    free(build.task);
+    free(build.top);
+    free(node);
+    free(build.tri);
+    free(build.centroid);
+    free(build.order);
+    return build.failed;
+}
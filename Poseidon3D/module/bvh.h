@@ -0,0 +1,70 @@
+#ifndef BVH_H
+#define BVH_H
+#include "poseidon.h"
+
+//=============================================================================
+// DATA SIGNS
+//=============================================================================
+
+#define BVH_SIGNATURE 0x31485642 //"BVH1"
+
+#define BVH_BINS      16  //SAH candidates per axis
+#define BVH_LEAF_SIZE 4   //Ranges this small are never split
+#define BVH_MAX_LEAF  16  //Ranges bigger than this are always split if possible
+#define BVH_MAX_DEPTH 64
+#define BVH_TASK_SIZE 1024 //Smallest range handed to its own thread
+
+//=============================================================================
+// PROTOTYPING
+//=============================================================================
+
+int WriteBVHFile(FILE *file, struct P3D *p3d);
+
+//=============================================================================
+// EXTERNING
+//=============================================================================
+
+//=============================================================================
+// BVH1 - bounding volume hierarchy sidecar
+//=============================================================================
+/*
+    struct BVHHeader   header;
+    struct BVHNode     node[nNodes];         //Depth first, node 0 is the root
+    struct BVHTriangle triangle[nTriangles]; //Leaf order
+*/
+// Everything is 4 byte aligned and the nodes start on a 64 byte boundary, so
+// the file can be mapped and used as is.
+//=============================================================================
+
+struct BVHHeader
+{
+    int    Signature;          //"BVH1"
+    int    nNodes;
+    int    nTriangles;
+    int    Reserved;
+    struct P3DTriplet Min;     //Model AABB
+    struct P3DTriplet Max;
+    struct P3DTriplet Center;  //Model bounding sphere
+    float  Radius;
+    int    Pad[2];
+};
+
+//=============================================================================
+
+struct BVHNode
+{
+    struct P3DTriplet Min;
+    struct P3DTriplet Max;
+    int    First;              //Leaf: first triangle, inner: right child (left child is the next node)
+    int    Count;              //Leaf: triangle count, inner: 0
+};
+
+//=============================================================================
+
+struct BVHTriangle
+{
+    struct P3DTriplet Vertex[3];
+    int    Face;               //P3DLodFace the triangle came from
+};
+
+#endif // BVH_H
@@ -0,0 +1,153 @@
+//=============================================================================
+//
+//  Module:         Common - small helpers shared by the converter modules
+//
+//  Author:         GameSpy
+//
+//  Date:           Started 19.10.2026
+//
+//=============================================================================
+// Array growth, strings, hashing, timing, file commits and quad triangulation,
+// kept in one place so the sidecars, the daemon and the watcher agree on them.
+//=============================================================================
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L //clock_gettime
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "common.h"
+
+//=============================================================================
+// Returns the (possibly moved) array with room for "needed" elements, NULL
+// if out of memory. Capacity doubles, starting at 256.
+
+void *GrowArray(void *data, int *capacity, int needed, size_t size)
+{
+    int newcap;
+
+    if (needed <= *capacity)
+    {
+        return data;
+    }
+    newcap = (*capacity) ? (*capacity) * 2 : 256;
+    while (newcap < needed) newcap *= 2;
+
+    data = realloc(data, newcap * size);
+    *capacity = data ? newcap : 0;
+    return data;
+}
+
+//=============================================================================
+// strdup is POSIX, not C89, and MSVC only has it as _strdup.
+
+char *CopyString(const char *text)
+{
+    size_t length = strlen(text) + 1;
+    char   *copy = (char *)malloc(length);
+
+    if (copy)
+    {
+        memcpy(copy, text, length);
+    }
+    return copy;
+}
+
+//=============================================================================
+// 64 bit FNV-1a, start with FNV64_OFFSET and chain calls to hash pieces.
+
+Hash64 HashBytes(Hash64 hash, const void *data, long nBytes)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    long                i;
+
+    for (i = 0; i < nBytes; i++)
+    {
+        hash = (hash ^ p[i]) * FNV64_PRIME;
+    }
+    return hash;
+}
+
+//=============================================================================
+
+Hash64 HashString(Hash64 hash, const char *text)
+{
+    while (*text)
+    {
+        hash = (hash ^ (unsigned char)*text++) * FNV64_PRIME;
+    }
+    return hash;
+}
+
+//=============================================================================
+
+double GetTimeMs(void)
+{
+    #ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+    #else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+    #endif
+}
+
+//=============================================================================
+// Moves a finished temporary file over its target, so readers only ever see
+// the old or the complete new file. Removes the temporary file on failure.
+
+int CommitTempFile(const char *temp, const char *path)
+{
+    #ifdef _WIN32
+    remove(path); //rename() does not replace here
+    #endif
+    if (rename(temp, path) != 0)
+    {
+        fprintf(stderr, "Alert: Error writing <%s>!\n", path);
+        remove(temp);
+        return 1;
+    }
+    return 0;
+}
+
+//=============================================================================
+
+int GetTriangleCount(struct P3D *p3d)
+{
+    int count = 0;
+    int i;
+
+    for (i = 0; i < p3d->data.nFaces; i++)
+    {
+        count += (p3d->lodface[i].FaceType == 3) ? 1 : 2;
+    }
+    return count;
+}
+
+//=============================================================================
+// P3D point indices of the face triangles, returns how many there are. Quads
+// split along 0-2, the meshlets and the BVH must agree on that.
+
+int GetFaceTriangles(const struct P3DLodFace *face, int tri[2][3])
+{
+    int count = (face->FaceType == 3) ? 1 : 2;
+    int k;
+
+    for (k = 0; k < count; k++)
+    {
+        tri[k][0] = face->p3dvertextable[0].PointsIndex;
+        tri[k][1] = face->p3dvertextable[k + 1].PointsIndex;
+        tri[k][2] = face->p3dvertextable[k + 2].PointsIndex;
+    }
+    return count;
+}
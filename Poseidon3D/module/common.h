@@ -0,0 +1,52 @@
+#ifndef COMMON_H
+#define COMMON_H
+#include "poseidon.h"
+
+//=============================================================================
+// DATA SIGNS
+//=============================================================================
+
+#ifdef _MSC_VER
+typedef unsigned __int64 Hash64;
+#define HASH64(x) x##ui64
+#else
+typedef unsigned long long Hash64;
+#define HASH64(x) x##ULL
+#endif
+
+#define FNV64_OFFSET HASH64(0xCBF29CE484222325)
+#define FNV64_PRIME  HASH64(0x00000100000001B3)
+
+//=============================================================================
+// PROTOTYPING
+//=============================================================================
+
+void *GrowArray(void *data, int *capacity, int needed, size_t size);
+
+//=============================================================================
+
+char *CopyString(const char *text);
+
+//=============================================================================
+
+Hash64 HashBytes(Hash64 hash, const void *data, long nBytes);
+Hash64 HashString(Hash64 hash, const char *text);
+
+//=============================================================================
+
+double GetTimeMs(void);
+
+//=============================================================================
+
+int CommitTempFile(const char *temp, const char *path);
+
+//=============================================================================
+
+int GetTriangleCount(struct P3D *p3d);
+int GetFaceTriangles(const struct P3DLodFace *face, int tri[2][3]);
+
+//=============================================================================
+// EXTERNING
+//=============================================================================
+
+#endif // COMMON_H
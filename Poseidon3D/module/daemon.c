@@ -0,0 +1,697 @@
+//=============================================================================
+//
+//  Module:         Daemon - long running conversion service
+//
+//  Author:         GameSpy
+//
+//  Date:           Started 19.10.2026
+//
+//=============================================================================
+// Requests come in over stdin/stdout or, outside Windows, a Unix domain
+// socket. Every session has a reader that queues requests, the shared worker
+// queue converts them and answers on the session that asked. The worker
+// threads and the conversion cache live as long as the daemon does.
+//=============================================================================
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L //fdopen, sockets
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+#include "daemon.h"
+#include "thread.h"
+#include "common.h"
+
+struct DaemonSession
+{
+    FILE        *in;
+    FILE        *out;
+    struct Lock *lock;     //Guards "out", "references" and "broken"
+    int         references; //Reader plus every request still in flight
+    int         broken;     //The client went away, answers are dropped
+};
+
+//=============================================================================
+
+struct DaemonRequest
+{
+    struct DaemonSession *session;
+    char                 Id[64];
+    char                 Input[260];
+    char                 Output[260];
+    char                 *Buffer;     //Inline payload, NULL for path requests
+    long                 nBytes;
+    int                  IsOBJ;
+    double               Queued;
+};
+
+//=============================================================================
+
+static ConvertProc              DaemonConvert;
+static SidecarProc              DaemonSidecars;
+static struct WorkQueue         *DaemonQueue;
+static struct Lock              *CacheLock;
+static struct Lock              *OutputLock[DAEMON_OUTPUT_LOCKS]; //Striped by output path
+static struct DaemonCacheEntry  Cache[DAEMON_CACHE_SIZE];
+static int                      CacheNext;
+
+//=============================================================================
+
+static int HasExtension(const char *path, const char *ext)
+{
+    const char *dot = strrchr(path, '.');
+    int        i;
+
+    if (!dot)
+    {
+        return 0;
+    }
+    for (i = 0; ext[i]; i++)
+    {
+        char c = dot[i + 1];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        if (c != ext[i]) return 0;
+    }
+    return dot[i + 1] == '\0';
+}
+
+//=============================================================================
+
+static int IsWVRFile(FILE *file)
+{
+    int signature = 0;
+
+    fread(&signature, sizeof(signature), 1, file);
+    rewind(file);
+    return signature == WVR1_SIGNATURE;
+}
+
+//=============================================================================
+// Copies a string into a fixed size field, always terminated. Returns 1 if
+// it had to be cut to fit.
+
+static int CopyField(char *field, size_t size, const char *text)
+{
+    size_t length = strlen(text);
+    int    cut = (length >= size);
+
+    if (cut) length = size - 1;
+    memcpy(field, text, length);
+    field[length] = '\0';
+    return cut;
+}
+
+//=============================================================================
+// A request is a hit when the same bytes were already converted into the
+// same output and that output and its sidecars are still there. Path inputs
+// are hashed too, mtimes only have a resolution of a second and miss quick
+// saves.
+
+static int FillCacheKey(struct DaemonRequest *request, struct DaemonCacheEntry *key)
+{
+    unsigned char buffer[65536];
+    FILE          *file;
+    size_t        length;
+
+    memset(key, 0, sizeof(struct DaemonCacheEntry));
+    memcpy(key->Output, request->Output, sizeof(key->Output)); //Same size, already terminated
+    key->Hash = FNV64_OFFSET;
+
+    if (request->Buffer)
+    {
+        key->Size = request->nBytes;
+        key->Hash = HashBytes(key->Hash, request->Buffer, request->nBytes);
+        return 0;
+    }
+
+    file = fopen(request->Input, "rb");
+    if (!file)
+    {
+        return 1;
+    }
+    memcpy(key->Input, request->Input, sizeof(key->Input));
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        key->Size += (long)length;
+        key->Hash = HashBytes(key->Hash, buffer, (long)length);
+    }
+    fclose(file);
+    return 0;
+}
+
+//=============================================================================
+
+static int LookupCache(struct DaemonCacheEntry *key)
+{
+    struct stat st;
+    int         i;
+    int         found = 0;
+
+    if (stat(key->Output, &st) != 0)
+    {
+        return 0;
+    }
+
+    EnterLock(CacheLock);
+    for (i = 0; i < DAEMON_CACHE_SIZE; i++)
+    {
+        if (Cache[i].Size == key->Size && Cache[i].Hash == key->Hash &&
+            strcmp(Cache[i].Input, key->Input) == 0 && strcmp(Cache[i].Output, key->Output) == 0)
+        {
+            found = 1;
+            break;
+        }
+    }
+    LeaveLock(CacheLock);
+    return found;
+}
+
+//=============================================================================
+
+static void StoreCache(struct DaemonCacheEntry *key)
+{
+    int i;
+
+    EnterLock(CacheLock);
+    for (i = 0; i < DAEMON_CACHE_SIZE; i++) //Same output, newer input: replace in place
+    {
+        if (strcmp(Cache[i].Output, key->Output) == 0)
+        {
+            break;
+        }
+    }
+    if (i == DAEMON_CACHE_SIZE)
+    {
+        i = CacheNext;
+        CacheNext = (CacheNext + 1) % DAEMON_CACHE_SIZE;
+    }
+    Cache[i] = *key;
+    LeaveLock(CacheLock);
+}
+
+//=============================================================================
+// A failed conversion can leave sidecars of the new input next to the old
+// output, so whatever was cached for that output is no hit anymore.
+
+static void DropCache(struct DaemonCacheEntry *key)
+{
+    int i;
+
+    EnterLock(CacheLock);
+    for (i = 0; i < DAEMON_CACHE_SIZE; i++)
+    {
+        if (strcmp(Cache[i].Output, key->Output) == 0)
+        {
+            memset(&Cache[i], 0, sizeof(struct DaemonCacheEntry)); //An empty output never matches a request
+        }
+    }
+    LeaveLock(CacheLock);
+}
+
+//=============================================================================
+
+static void ReleaseSession(struct DaemonSession *session)
+{
+    int references;
+
+    EnterLock(session->lock);
+    references = --session->references;
+    LeaveLock(session->lock);
+
+    if (references == 0)
+    {
+        if (session->in != stdin)   fclose(session->in);
+        if (session->out != stdout) fclose(session->out);
+        DestroyLock(session->lock);
+        free(session);
+    }
+}
+
+//=============================================================================
+
+static void Respond(struct DaemonSession *session, const char *line)
+{
+    EnterLock(session->lock);
+    if (!session->broken && (fputs(line, session->out) == EOF || fflush(session->out) == EOF))
+    {
+        session->broken = 1; //Only this session ends, the reader stops at the next line
+    }
+    LeaveLock(session->lock);
+}
+
+//=============================================================================
+
+static int IsSessionBroken(struct DaemonSession *session)
+{
+    int broken;
+
+    EnterLock(session->lock);
+    broken = session->broken;
+    LeaveLock(session->lock);
+    return broken;
+}
+
+//=============================================================================
+
+static void ProcessRequest(void *item)
+{
+    struct DaemonRequest    *request = (struct DaemonRequest *)item;
+    struct DaemonCacheEntry key;
+    struct Lock             *lock = OutputLock[HashString(FNV64_OFFSET, request->Output) % DAEMON_OUTPUT_LOCKS];
+    char                    line[DAEMON_LINE_SIZE];
+    char                    temp[sizeof(request->Output) + 8];
+    double                  start, loaded, converted;
+    FILE                    *f_in = NULL;
+    FILE                    *f_out = NULL;
+    int                     cached = 0;
+    int                     failed = 0;
+
+    //One request per output at a time, from the cache lookup to the commit
+    EnterLock(lock);
+    start = GetTimeMs(); //Waiting for the output counts as queue time
+    sprintf(temp, "%s.tmp", request->Output);
+
+    if (FillCacheKey(request, &key))
+    {
+        sprintf(line, "%s\tERROR\tcannot open input\n", request->Id);
+        goto done;
+    }
+    if (LookupCache(&key) && !DaemonSidecars(request->IsOBJ, request->Output)) //.mtl, .mlt and .bvh have to be there too
+    {
+        cached = 1;
+        loaded = converted = GetTimeMs();
+    }
+    else
+    {
+        if (request->Buffer) //Readers want a FILE, a temporary one is portable
+        {
+            f_in = tmpfile();
+            if (f_in)
+            {
+                fwrite(request->Buffer, 1, request->nBytes, f_in);
+                rewind(f_in);
+            }
+        }
+        else
+        {
+            f_in = fopen(request->Input, "rb");
+        }
+        if (!f_in)
+        {
+            sprintf(line, "%s\tERROR\tcannot open input\n", request->Id);
+            goto done;
+        }
+        if (!request->IsOBJ && IsWVRFile(f_in)) //No model in there, only -terrain does something with maps
+        {
+            sprintf(line, "%s\tERROR\tmaps are not supported, use -terrain\n", request->Id);
+            goto done;
+        }
+        f_out = fopen(temp, request->IsOBJ ? "wb" : "w");
+        if (!f_out)
+        {
+            sprintf(line, "%s\tERROR\tcannot open output\n", request->Id);
+            goto done;
+        }
+        loaded = GetTimeMs();
+
+        failed = DaemonConvert(f_in, request->IsOBJ, f_out, request->Output);
+        failed |= (fclose(f_out) != 0);
+        f_out = NULL;
+        converted = GetTimeMs();
+
+        if (failed)
+        {
+            remove(temp);
+            DropCache(&key); //The sidecars may already be from this input
+            sprintf(line, "%s\tERROR\tconversion failed\n", request->Id);
+            goto done;
+        }
+        if (CommitTempFile(temp, request->Output))
+        {
+            DropCache(&key);
+            sprintf(line, "%s\tERROR\tcannot write output\n", request->Id);
+            goto done;
+        }
+        StoreCache(&key);
+    }
+
+    sprintf(line, "%s\tOK\tcached=%d\tqueue_ms=%.3f\tread_ms=%.3f\tconvert_ms=%.3f\ttotal_ms=%.3f\n",
+            request->Id, cached,
+            start - request->Queued,
+            loaded - start,
+            converted - loaded,
+            converted - request->Queued);
+
+done:
+    if (f_in)  fclose(f_in);
+    if (f_out)
+    {
+        fclose(f_out);
+        remove(temp);
+    }
+    LeaveLock(lock);
+
+    Respond(request->session, line);
+    ReleaseSession(request->session);
+    free(request->Buffer);
+    free(request);
+}
+
+//=============================================================================
+// Splits a request line in place, returns the number of fields.
+
+static int SplitFields(char *line, char **field, int maxFields)
+{
+    int  count = 0;
+    char *p = line;
+
+    p[strcspn(p, "\r\n")] = '\0';
+    while (count < maxFields)
+    {
+        field[count++] = p;
+        p = strchr(p, '\t');
+        if (!p)
+        {
+            break;
+        }
+        *p++ = '\0';
+    }
+    return count;
+}
+
+//=============================================================================
+
+static struct DaemonRequest *ParseRequest(struct DaemonSession *session, char *line)
+{
+    struct DaemonRequest *request;
+    char                 *field[6];
+    char                 reply[DAEMON_LINE_SIZE];
+    int                  nFields = SplitFields(line, field, 6);
+    int                  tooLong;
+
+    request = (struct DaemonRequest *)calloc(1, sizeof(struct DaemonRequest));
+    if (!request)
+    {
+        return NULL;
+    }
+    if (nFields >= 2)
+    {
+        CopyField(request->Id, sizeof(request->Id), field[1]); //Only echoed back, cutting it is harmless
+    }
+
+    if (nFields == 4 && strcmp(field[0], "CONVERT") == 0)
+    {
+        if (CopyField(request->Input, sizeof(request->Input), field[2]) ||
+            CopyField(request->Output, sizeof(request->Output), field[3]))
+        {
+            sprintf(reply, "%s\tERROR\tpath too long\n", request->Id);
+            Respond(session, reply);
+            free(request);
+            return NULL;
+        }
+        request->IsOBJ = HasExtension(request->Input, "obj");
+        return request;
+    }
+
+    if (nFields == 5 && strcmp(field[0], "BUFFER") == 0)
+    {
+        request->nBytes = atol(field[2]);
+        tooLong = CopyField(request->Output, sizeof(request->Output), field[4]);
+        request->IsOBJ = (strcmp(field[3], "obj") == 0);
+
+        if (request->nBytes <= 0 || request->nBytes > DAEMON_MAX_BUFFER ||
+            !(request->Buffer = (char *)malloc(request->nBytes)))
+        {
+            sprintf(reply, "%s\tERROR\tbad buffer size\n", request->Id);
+            Respond(session, reply);
+            free(request);
+            return NULL;
+        }
+        if (fread(request->Buffer, 1, request->nBytes, session->in) != (size_t)request->nBytes)
+        {
+            free(request->Buffer);
+            free(request);
+            return NULL;
+        }
+        if (tooLong) //Only now, the payload had to be consumed first
+        {
+            sprintf(reply, "%s\tERROR\tpath too long\n", request->Id);
+            Respond(session, reply);
+            free(request->Buffer);
+            free(request);
+            return NULL;
+        }
+        return request;
+    }
+
+    sprintf(reply, "%s\tERROR\tunknown request\n", request->Id[0] ? request->Id : "-");
+    Respond(session, reply);
+    free(request);
+    return NULL;
+}
+
+//=============================================================================
+// fgets stopped before the end of the line. The rest is no request of its
+// own: it is skipped, together with the payload of a BUFFER, and the whole
+// line is answered with one ERROR.
+
+static void RejectLongLine(struct DaemonSession *session, char *line)
+{
+    char reply[DAEMON_LINE_SIZE];
+    char id[64];
+    char *field[3];
+    int  nFields = SplitFields(line, field, 3);
+    long nBytes = 0;
+    int  c;
+
+    CopyField(id, sizeof(id), (nFields >= 2 && field[1][0]) ? field[1] : "-");
+    if (nFields == 3 && strcmp(field[0], "BUFFER") == 0)
+    {
+        nBytes = atol(field[2]);
+    }
+
+    while ((c = getc(session->in)) != EOF && c != '\n')
+    {
+    }
+    while (nBytes > 0 && nBytes <= DAEMON_MAX_BUFFER && getc(session->in) != EOF)
+    {
+        nBytes--;
+    }
+
+    sprintf(reply, "%s\tERROR\tline too long\n", id);
+    Respond(session, reply);
+}
+
+//=============================================================================
+
+static void ReadSession(void *context)
+{
+    struct DaemonSession *session = (struct DaemonSession *)context;
+    struct DaemonRequest *request;
+    char                 line[DAEMON_LINE_SIZE];
+    size_t               length;
+
+    while (!IsSessionBroken(session) && fgets(line, sizeof(line), session->in))
+    {
+        length = strlen(line);
+        if (length == sizeof(line) - 1 && line[length - 1] != '\n')
+        {
+            RejectLongLine(session, line);
+            continue;
+        }
+        if (strncmp(line, "QUIT", 4) == 0)
+        {
+            break;
+        }
+        if (line[0] == '\n' || line[0] == '\r')
+        {
+            continue;
+        }
+
+        request = ParseRequest(session, line);
+        if (!request)
+        {
+            continue;
+        }
+        request->session = session;
+        request->Queued = GetTimeMs();
+
+        EnterLock(session->lock);
+        session->references++;
+        LeaveLock(session->lock);
+
+        PushWork(DaemonQueue, request);
+    }
+    ReleaseSession(session);
+}
+
+//=============================================================================
+
+static struct DaemonSession *CreateSession(FILE *in, FILE *out)
+{
+    struct DaemonSession *session = (struct DaemonSession *)malloc(sizeof(struct DaemonSession));
+
+    if (!session)
+    {
+        return NULL;
+    }
+    session->in = in;
+    session->out = out;
+    session->lock = CreateLock();
+    session->references = 1;
+    session->broken = 0;
+    return session;
+}
+
+//=============================================================================
+
+#ifndef _WIN32
+static int ListenSocket(const char *socket_path)
+{
+    struct sockaddr_un address;
+    int                server;
+    int                client;
+
+    server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0)
+    {
+        fprintf(stderr, "Alert: Error creating socket!\n");
+        return 1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (CopyField(address.sun_path, sizeof(address.sun_path), socket_path))
+    {
+        fprintf(stderr, "Alert: Socket path <%s> is too long!\n", socket_path);
+        close(server);
+        return 1;
+    }
+    unlink(socket_path);
+
+    if (bind(server, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(server, 64) != 0)
+    {
+        fprintf(stderr, "Alert: Error binding <%s>!\n", socket_path);
+        close(server);
+        return 1;
+    }
+
+    while (1)
+    {
+        struct DaemonSession *session;
+        FILE                 *in;
+        FILE                 *out;
+        int                  copy;
+
+        client = accept(server, NULL, NULL);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED) //A signal or a client that gave up, not our socket
+            {
+                continue;
+            }
+            fprintf(stderr, "Alert: Error accepting on <%s>!\n", socket_path);
+            break;
+        }
+
+        copy = dup(client);
+        in = fdopen(client, "rb");
+        out = (copy >= 0) ? fdopen(copy, "wb") : NULL;
+        if (!in || !out || !(session = CreateSession(in, out)))
+        {
+            if (in)             fclose(in);
+            else                close(client);
+            if (out)            fclose(out);
+            else if (copy >= 0) close(copy);
+            continue;
+        }
+        if (StartThread(ReadSession, session))
+        {
+            ReleaseSession(session);
+        }
+    }
+
+    close(server);
+    unlink(socket_path);
+    return 1;
+}
+#endif
+
+//=============================================================================
+
+int RunDaemon(const char *socket_path, ConvertProc convert, SidecarProc sidecars)
+{
+    struct DaemonSession *session;
+    int                  result = 0;
+    int                  missing = 0;
+    int                  i;
+
+    DaemonConvert = convert;
+    DaemonSidecars = sidecars;
+    #ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN); //A client that hangs up must not take the daemon with it
+    #endif
+    CacheLock = CreateLock();
+    for (i = 0; i < DAEMON_OUTPUT_LOCKS; i++)
+    {
+        OutputLock[i] = CreateLock();
+        missing |= !OutputLock[i];
+    }
+    DaemonQueue = CreateWorkQueue(ProcessRequest);
+    if (!CacheLock || missing || !DaemonQueue)
+    {
+        fprintf(stderr, "Alert: Error starting daemon!\n");
+        return 1;
+    }
+
+    if (socket_path)
+    {
+        #ifdef _WIN32
+        fprintf(stderr, "Alert: Sockets are not supported here, use stdin/stdout!\n");
+        result = 1;
+        #else
+        result = ListenSocket(socket_path);
+        #endif
+    }
+    else
+    {
+        #ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+        #endif
+        session = CreateSession(stdin, stdout);
+        if (session)
+        {
+            session->references++; //Keep it alive until the queue is drained
+            ReadSession(session);
+        }
+        DestroyWorkQueue(DaemonQueue);
+        DaemonQueue = NULL;
+        if (session)
+        {
+            ReleaseSession(session);
+        }
+    }
+
+    if (DaemonQueue) DestroyWorkQueue(DaemonQueue);
+    DestroyLock(CacheLock);
+    for (i = 0; i < DAEMON_OUTPUT_LOCKS; i++)
+    {
+        DestroyLock(OutputLock[i]);
+    }
+    return result;
+}
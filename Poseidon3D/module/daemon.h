@@ -0,0 +1,54 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+#include <stdio.h>
+#include "common.h"
+
+//=============================================================================
+// DATA SIGNS
+//=============================================================================
+
+#define DAEMON_LINE_SIZE    2048
+#define DAEMON_CACHE_SIZE   1024
+#define DAEMON_OUTPUT_LOCKS 64         //Requests for the same output never overlap
+#define DAEMON_MAX_BUFFER   0x10000000 //256MB, anything bigger is a broken request
+
+//=============================================================================
+// PROTOTYPING
+//=============================================================================
+
+typedef int (*ConvertProc)(FILE *f_in, int isobj, FILE *f_out, const char *output_file);
+typedef int (*SidecarProc)(int isobj, const char *output_file); //1 if a file written next to the output is missing
+
+//=============================================================================
+
+int RunDaemon(const char *socket_path, ConvertProc convert, SidecarProc sidecars);
+
+//=============================================================================
+// EXTERNING
+//=============================================================================
+
+//=============================================================================
+// Protocol - one request per line, fields separated by TAB
+//=============================================================================
+/*
+    CONVERT <id> <input_path> <output_path>
+    BUFFER  <id> <nbytes> <obj|p3d> <output_path>  followed by <nbytes> raw bytes
+    QUIT
+
+    <id> OK cached=<0|1> queue_ms=<t> read_ms=<t> convert_ms=<t> total_ms=<t>
+    <id> ERROR <reason>
+
+    A line longer than DAEMON_LINE_SIZE is skipped as a whole, BUFFER payload
+    included, and answered with <id> ERROR line too long.
+*/
+//=============================================================================
+
+struct DaemonCacheEntry
+{
+    char          Input[260];  //Empty for inline buffers
+    char          Output[260];
+    long          Size;
+    Hash64        Hash;        //64 bit FNV-1a of the input bytes
+};
+
+#endif // DAEMON_H
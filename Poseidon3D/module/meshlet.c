@@ -0,0 +1,539 @@
+//=============================================================================
+//
+//  Module:         Meshlet - cluster building for converted models
+//
+//  Author:         GameSpy
+//
+//  Date:           Started 19.10.2026
+//
+//=============================================================================
+// Faces are triangulated and grouped by texture, every group is clustered on
+// its own thread. A cluster grows greedily through shared points, always
+// taking the neighbour that adds the fewest new vertices, and is closed once
+// MESHLET_MAX_VERTICES or MESHLET_MAX_TRIANGLES would be exceeded.
+//=============================================================================
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "meshlet.h"
+#include "thread.h"
+#include "common.h"
+
+struct MeshletGroup
+{
+    int            First;      //Range in MeshletBuild.order
+    int            Count;
+
+    struct Meshlet *meshlet;   int nMeshlets,  capMeshlets;
+    int            *vertex;    int nVertices,  capVertices;
+    unsigned char  *triangle;  int nTriangles, capTriangles;
+    int            *face;      int capFaces;
+};
+
+//=============================================================================
+
+struct MeshletSortKey //The sort carries its own key, qsort has no context pointer
+{
+    char TextureName[32];
+    int  Face;
+};
+
+//=============================================================================
+
+struct MeshletBuild
+{
+    struct P3D          *p3d;
+    int                 (*tri)[3];  //Triangulated faces, P3D point indices
+    int                 *triFace;
+    int                 *triGroup;
+    int                 nTris;
+    int                 *order;     //Triangles sorted by texture
+    int                 *adjStart;  //Point -> triangles, CSR
+    int                 *adjTris;
+    char                *assigned;
+    struct MeshletGroup *group;
+    int                 nGroups;
+    int                 failed;
+};
+
+//=============================================================================
+
+static int CompareTexture(const void *a, const void *b)
+{
+    const struct MeshletSortKey *ka = (const struct MeshletSortKey *)a;
+    const struct MeshletSortKey *kb = (const struct MeshletSortKey *)b;
+    int                         result = strncmp(ka->TextureName, kb->TextureName, 32);
+
+    return result ? result : ka->Face - kb->Face; //Keep file order inside a texture, it is usually spatially coherent
+}
+
+//=============================================================================
+
+static int FindLocal(const int *vertex, int count, int point)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (vertex[i] == point) return i;
+    }
+    return -1;
+}
+
+//=============================================================================
+// Returns 0 for degenerate triangles, they say nothing about facing.
+
+static int GetTriangleNormal(struct MeshletBuild *build, struct MeshletGroup *group, struct Meshlet *m, int t, float n[3])
+{
+    unsigned char     *local = &group->triangle[(m->FirstTriangle + t) * 3];
+    struct P3DTriplet *a = &build->p3d->point[group->vertex[m->FirstVertex + local[0]]].position;
+    struct P3DTriplet *b = &build->p3d->point[group->vertex[m->FirstVertex + local[1]]].position;
+    struct P3DTriplet *c = &build->p3d->point[group->vertex[m->FirstVertex + local[2]]].position;
+    float             e1[3], e2[3];
+    float             length;
+    int               k;
+
+    for (k = 0; k < 3; k++)
+    {
+        e1[k] = b->XYZ[k] - a->XYZ[k];
+        e2[k] = c->XYZ[k] - a->XYZ[k];
+    }
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    length = (float)sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length <= 0.0f)
+    {
+        return 0;
+    }
+    for (k = 0; k < 3; k++) n[k] /= length;
+    return 1;
+}
+
+//=============================================================================
+
+static void FinishMeshlet(struct MeshletBuild *build, struct MeshletGroup *group, struct Meshlet *m)
+{
+    struct P3D        *p3d = build->p3d;
+    struct P3DTriplet bmin, bmax, axis;
+    float             radius = 0.0f;
+    float             cutoff = 1.0f;
+    float             length;
+    float             n[3];
+    int               i,k;
+
+    bmin = bmax = p3d->point[group->vertex[m->FirstVertex]].position;
+    for (i = 1; i < m->nVertices; i++)
+    {
+        struct P3DTriplet *p = &p3d->point[group->vertex[m->FirstVertex + i]].position;
+        for (k = 0; k < 3; k++)
+        {
+            if (p->XYZ[k] < bmin.XYZ[k]) bmin.XYZ[k] = p->XYZ[k];
+            if (p->XYZ[k] > bmax.XYZ[k]) bmax.XYZ[k] = p->XYZ[k];
+        }
+    }
+    for (k = 0; k < 3; k++)
+    {
+        m->Center.XYZ[k] = (bmin.XYZ[k] + bmax.XYZ[k]) * 0.5f;
+    }
+    for (i = 0; i < m->nVertices; i++)
+    {
+        struct P3DTriplet *p = &p3d->point[group->vertex[m->FirstVertex + i]].position;
+        float dx = p->XYZ[0] - m->Center.XYZ[0];
+        float dy = p->XYZ[1] - m->Center.XYZ[1];
+        float dz = p->XYZ[2] - m->Center.XYZ[2];
+        float d = dx * dx + dy * dy + dz * dz;
+        if (d > radius) radius = d;
+    }
+    m->Radius = (float)sqrt(radius);
+
+    //Normal cone from the geometric normals, P3D face normals may be smoothed
+    memset(&axis, 0, sizeof(axis));
+    for (i = 0; i < m->nTriangles; i++)
+    {
+        if (GetTriangleNormal(build, group, m, i, n))
+        {
+            for (k = 0; k < 3; k++) axis.XYZ[k] += n[k];
+        }
+    }
+    length = (float)sqrt(axis.XYZ[0] * axis.XYZ[0] + axis.XYZ[1] * axis.XYZ[1] + axis.XYZ[2] * axis.XYZ[2]);
+    for (k = 0; k < 3; k++) axis.XYZ[k] = (length > 0.0f) ? axis.XYZ[k] / length : 0.0f;
+
+    for (i = 0; i < m->nTriangles; i++)
+    {
+        if (GetTriangleNormal(build, group, m, i, n))
+        {
+            float d = axis.XYZ[0] * n[0] + axis.XYZ[1] * n[1] + axis.XYZ[2] * n[2];
+            if (d < cutoff) cutoff = d;
+        }
+    }
+    m->ConeAxis = axis;
+    m->ConeCutoff = (axis.XYZ[0] == 0.0f && axis.XYZ[1] == 0.0f && axis.XYZ[2] == 0.0f) ? -1.0f : cutoff;
+}
+
+//=============================================================================
+
+static int AddTriangle(struct MeshletBuild *build, struct MeshletGroup *group, struct Meshlet *m, int t)
+{
+    int k;
+
+    group->triangle = (unsigned char *)GrowArray(group->triangle, &group->capTriangles, (group->nTriangles + 1) * 3, 1);
+    group->face = (int *)GrowArray(group->face, &group->capFaces, group->nTriangles + 1, sizeof(int));
+    group->vertex = (int *)GrowArray(group->vertex, &group->capVertices, group->nVertices + 3, sizeof(int));
+    if (!group->triangle || !group->face || !group->vertex)
+    {
+        return 1;
+    }
+
+    for (k = 0; k < 3; k++)
+    {
+        int point = build->tri[t][k];
+        int local = FindLocal(&group->vertex[m->FirstVertex], m->nVertices, point);
+
+        if (local < 0)
+        {
+            local = m->nVertices++;
+            group->vertex[group->nVertices++] = point;
+        }
+        group->triangle[group->nTriangles * 3 + k] = (unsigned char)local;
+    }
+    group->face[group->nTriangles++] = build->triFace[t];
+    m->nTriangles++;
+    build->assigned[t] = 1;
+    return 0;
+}
+
+//=============================================================================
+
+static int CountShared(struct MeshletBuild *build, struct MeshletGroup *group, struct Meshlet *m, int t)
+{
+    int shared = 0;
+    int k;
+
+    for (k = 0; k < 3; k++)
+    {
+        if (FindLocal(&group->vertex[m->FirstVertex], m->nVertices, build->tri[t][k]) >= 0) shared++;
+    }
+    return shared;
+}
+
+//=============================================================================
+// Squared distance from the triangle centroid to the cluster centroid,
+// breaks ties so clusters grow round instead of along a strip.
+
+static float GetDistance(struct MeshletBuild *build, const float centroid[3], int t)
+{
+    float d = 0.0f;
+    int   k;
+
+    for (k = 0; k < 3; k++)
+    {
+        float c = (build->p3d->point[build->tri[t][0]].position.XYZ[k] +
+                   build->p3d->point[build->tri[t][1]].position.XYZ[k] +
+                   build->p3d->point[build->tri[t][2]].position.XYZ[k]) / 3.0f - centroid[k];
+        d += c * c;
+    }
+    return d;
+}
+
+//=============================================================================
+
+static void BuildGroup(void *context, int index)
+{
+    struct MeshletBuild *build = (struct MeshletBuild *)context;
+    struct MeshletGroup *group = &build->group[index];
+    struct Meshlet      *m = NULL;
+    int                 *candidate = NULL;
+    int                 nCandidates = 0, capCandidates = 0;
+    int                 next = 0; //Fallback seed, next unassigned in texture order
+    float               sum[3];   //Sum of the cluster triangle centroids
+    float               centroid[3];
+    int                 i,k;
+
+    while (1)
+    {
+        int   best = -1;
+        int   bestShared = -1;
+        float bestDistance = 0.0f;
+
+        for (k = 0; k < 3; k++)
+        {
+            centroid[k] = m ? sum[k] / m->nTriangles : 0.0f;
+        }
+
+        for (i = 0; i < nCandidates; i++) //Drop stale candidates and pick the best one
+        {
+            int   t = candidate[i];
+            int   shared;
+            float distance;
+
+            if (build->assigned[t])
+            {
+                candidate[i--] = candidate[--nCandidates];
+                continue;
+            }
+            shared = m ? CountShared(build, group, m, t) : 0;
+            distance = m ? GetDistance(build, centroid, t) : 0.0f;
+            if (shared > bestShared || (shared == bestShared && distance < bestDistance))
+            {
+                best = t;
+                bestShared = shared;
+                bestDistance = distance;
+            }
+        }
+        if (best < 0)
+        {
+            while (next < group->Count && build->assigned[build->order[group->First + next]]) next++;
+            if (next == group->Count)
+            {
+                break;
+            }
+            best = build->order[group->First + next];
+            bestShared = m ? CountShared(build, group, m, best) : 0;
+        }
+
+        if (m && (m->nVertices + 3 - bestShared > MESHLET_MAX_VERTICES || m->nTriangles + 1 > MESHLET_MAX_TRIANGLES))
+        {
+            FinishMeshlet(build, group, m);
+            m = NULL;
+            nCandidates = 0; //The next cluster starts from "best", right next to this one
+        }
+        if (!m)
+        {
+            group->meshlet = (struct Meshlet *)GrowArray(group->meshlet, &group->capMeshlets, group->nMeshlets + 1, sizeof(struct Meshlet));
+            if (!group->meshlet)
+            {
+                build->failed = 1;
+                break;
+            }
+            m = &group->meshlet[group->nMeshlets++];
+            memset(m, 0, sizeof(struct Meshlet));
+            m->FirstVertex = group->nVertices;
+            m->FirstTriangle = group->nTriangles;
+            sum[0] = sum[1] = sum[2] = 0.0f;
+            memcpy(m->TextureName, build->p3d->lodface[build->triFace[best]].TextureName, 31);
+            m->TextureName[31] = '\0';
+        }
+
+        if (AddTriangle(build, group, m, best))
+        {
+            build->failed = 1;
+            break;
+        }
+        for (k = 0; k < 3; k++)
+        {
+            sum[k] += (build->p3d->point[build->tri[best][0]].position.XYZ[k] +
+                       build->p3d->point[build->tri[best][1]].position.XYZ[k] +
+                       build->p3d->point[build->tri[best][2]].position.XYZ[k]) / 3.0f;
+        }
+
+        for (k = 0; k < 3; k++) //Everything sharing a point with the new triangle is a candidate
+        {
+            int point = build->tri[best][k];
+            for (i = build->adjStart[point]; i < build->adjStart[point + 1]; i++)
+            {
+                int t = build->adjTris[i];
+                if (build->assigned[t] || build->triGroup[t] != index) continue;
+
+                candidate = (int *)GrowArray(candidate, &capCandidates, nCandidates + 1, sizeof(int));
+                if (!candidate)
+                {
+                    build->failed = 1;
+                    return;
+                }
+                candidate[nCandidates++] = t;
+            }
+        }
+    }
+
+    if (m)
+    {
+        FinishMeshlet(build, group, m);
+    }
+    free(candidate);
+}
+
+//=============================================================================
+
+static int Triangulate(struct MeshletBuild *build)
+{
+    struct P3D            *p3d = build->p3d;
+    struct MeshletSortKey *faceOrder;
+    int                   i,k,n;
+
+    build->nTris = GetTriangleCount(p3d);
+
+    build->tri = (int (*)[3])malloc((build->nTris + 1) * sizeof(int[3]));
+    build->triFace = (int *)malloc((build->nTris + 1) * sizeof(int));
+    build->triGroup = (int *)malloc((build->nTris + 1) * sizeof(int));
+    build->order = (int *)malloc((build->nTris + 1) * sizeof(int));
+    build->assigned = (char *)calloc(build->nTris + 1, 1);
+    build->adjStart = (int *)calloc(p3d->data.nPoints + 1, sizeof(int));
+    build->adjTris = (int *)malloc((build->nTris * 3 + 1) * sizeof(int));
+    build->group = (struct MeshletGroup *)calloc(p3d->data.nFaces + 1, sizeof(struct MeshletGroup));
+    faceOrder = (struct MeshletSortKey *)malloc((p3d->data.nFaces + 1) * sizeof(struct MeshletSortKey));
+    if (!build->tri || !build->triFace || !build->triGroup || !build->order || !build->assigned ||
+        !build->adjStart || !build->adjTris || !build->group || !faceOrder)
+    {
+        free(faceOrder);
+        return 1;
+    }
+
+    //Faces sorted by texture, triangles are emitted in that order so groups are contiguous
+    for (i = 0; i < p3d->data.nFaces; i++)
+    {
+        memcpy(faceOrder[i].TextureName, p3d->lodface[i].TextureName, 32);
+        faceOrder[i].Face = i;
+    }
+    qsort(faceOrder, p3d->data.nFaces, sizeof(struct MeshletSortKey), CompareTexture);
+
+    n = 0;
+    build->nGroups = 0;
+    for (i = 0; i < p3d->data.nFaces; i++)
+    {
+        int               f = faceOrder[i].Face;
+        struct P3DLodFace *face = &p3d->lodface[f];
+        int               tri[2][3];
+        int               count = GetFaceTriangles(face, tri);
+
+        if (i == 0 || strncmp(faceOrder[i].TextureName, faceOrder[i - 1].TextureName, 32) != 0)
+        {
+            build->group[build->nGroups++].First = n;
+        }
+        for (k = 0; k < count; k++)
+        {
+            memcpy(build->tri[n], tri[k], sizeof(tri[k]));
+            build->triFace[n] = f;
+            build->triGroup[n] = build->nGroups - 1;
+            build->order[n] = n;
+            n++;
+        }
+    }
+    for (i = 0; i < build->nGroups; i++)
+    {
+        build->group[i].Count = ((i + 1 < build->nGroups) ? build->group[i + 1].First : n) - build->group[i].First;
+    }
+    free(faceOrder);
+
+    for (i = 0; i < build->nTris; i++) //Point -> triangle adjacency
+    {
+        for (k = 0; k < 3; k++)
+        {
+            int point = build->tri[i][k];
+            if (point < 0 || point >= p3d->data.nPoints)
+            {
+                fprintf(stderr, "Alert: Face %d points outside the point table!\n", build->triFace[i]);
+                return 1;
+            }
+            build->adjStart[point + 1]++;
+        }
+    }
+    for (i = 0; i < p3d->data.nPoints; i++)
+    {
+        build->adjStart[i + 1] += build->adjStart[i];
+    }
+    {
+        int *fill = (int *)malloc((p3d->data.nPoints + 1) * sizeof(int));
+        if (!fill)
+        {
+            return 1;
+        }
+        memcpy(fill, build->adjStart, (p3d->data.nPoints + 1) * sizeof(int));
+        for (i = 0; i < build->nTris; i++)
+        {
+            for (k = 0; k < 3; k++)
+            {
+                build->adjTris[fill[build->tri[i][k]]++] = i;
+            }
+        }
+        free(fill);
+    }
+    return 0;
+}
+
+//=============================================================================
+
+int WriteMeshletFile(FILE *file, struct P3D *p3d)
+{
+    struct MeshletBuild build;
+    int                 header[4];
+    int                 vbase = 0, tbase = 0;
+    int                 i,j;
+
+    memset(&build, 0, sizeof(build));
+    build.p3d = p3d;
+
+    if (Triangulate(&build))
+    {
+        build.failed = 1;
+    }
+    else
+    {
+        ParallelFor(build.nGroups, BuildGroup, &build);
+    }
+
+    if (!build.failed)
+    {
+        header[0] = MESHLET_SIGNATURE;
+        header[1] = header[2] = header[3] = 0;
+        for (i = 0; i < build.nGroups; i++)
+        {
+            header[1] += build.group[i].nMeshlets;
+            header[2] += build.group[i].nVertices;
+            header[3] += build.group[i].nTriangles;
+        }
+        fwrite(header, sizeof(int), 4, file);
+
+        for (i = 0; i < build.nGroups; i++) //Group local offsets become file global
+        {
+            for (j = 0; j < build.group[i].nMeshlets; j++)
+            {
+                struct Meshlet m = build.group[i].meshlet[j];
+                m.FirstVertex += vbase;
+                m.FirstTriangle += tbase;
+                fwrite(&m, sizeof(struct Meshlet), 1, file);
+            }
+            vbase += build.group[i].nVertices;
+            tbase += build.group[i].nTriangles;
+        }
+        for (i = 0; i < build.nGroups; i++)
+        {
+            fwrite(build.group[i].vertex, sizeof(int), build.group[i].nVertices, file);
+        }
+        for (i = 0; i < build.nGroups; i++)
+        {
+            fwrite(build.group[i].triangle, 3, build.group[i].nTriangles, file);
+        }
+        for (i = 0; i < build.nGroups; i++)
+        {
+            fwrite(build.group[i].face, sizeof(int), build.group[i].nTriangles, file);
+        }
+
+        #ifdef _DEBUG
+        printf("Debug: Meshlets: %d (%d vertices, %d triangles)\n", header[1], header[2], header[3]);
+        #endif
+    }
+    else
+    {
+        fprintf(stderr, "Alert: Error building meshlets!\n");
+    }
+
+    for (i = 0; build.group && i < build.nGroups; i++)
+    {
+        free(build.group[i].meshlet);
+        free(build.group[i].vertex);
+        free(build.group[i].triangle);
+        free(build.group[i].face);
+    }
+    free(build.group);
+    free(build.tri);
+    free(build.triFace);
+    free(build.triGroup);
+    free(build.order);
+    free(build.assigned);
+    free(build.adjStart);
+    free(build.adjTris);
+    return build.failed;
+}
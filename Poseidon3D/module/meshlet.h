@@ -0,0 +1,52 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+#include "poseidon.h"
+
+//=============================================================================
+// DATA SIGNS
+//=============================================================================
+
+#define MESHLET_SIGNATURE 0x31544C4D //"MLT1"
+
+#define MESHLET_MAX_VERTICES  64
+#define MESHLET_MAX_TRIANGLES 124
+
+//=============================================================================
+// PROTOTYPING
+//=============================================================================
+
+int WriteMeshletFile(FILE *file, struct P3D *p3d);
+
+//=============================================================================
+// EXTERNING
+//=============================================================================
+
+//=============================================================================
+// MLT1 - meshlet sidecar
+//=============================================================================
+/*
+    int            Signature;               //"MLT1"
+    int            nMeshlets;
+    int            nVertices;
+    int            nTriangles;
+    struct Meshlet meshlet[nMeshlets];
+    int            Vertices[nVertices];     //P3D point index
+    unsigned char  Triangles[nTriangles*3]; //Meshlet local vertex index
+    int            Faces[nTriangles];       //P3DLodFace the triangle came from
+*/
+//=============================================================================
+
+struct Meshlet
+{
+    int    FirstVertex;
+    int    nVertices;
+    int    FirstTriangle;
+    int    nTriangles;
+    struct P3DTriplet Center;     //Bounding sphere
+    float  Radius;
+    struct P3DTriplet ConeAxis;   //Average facing of the triangles
+    float  ConeCutoff;            //Smallest dot(axis, normal), <= 0 means the cone is useless
+    char   TextureName[32];
+};
+
+#endif // MESHLET_H
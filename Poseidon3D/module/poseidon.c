@@ -16,16 +16,23 @@
 #include <stdio.h>
 #include <string.h>
 #include "poseidon.h"
+#include "validate.h"
+#include "common.h"
 
-void ReadP3DData(FILE *file, struct P3D *p3d)
+int ReadP3DData(FILE *file, struct P3D *p3d)
 {
-    fread(&p3d->data, sizeof(struct P3DData), 1, file);
+    if (fread(&p3d->data, sizeof(struct P3DData), 1, file) != 1)
+    {
+        fprintf(stderr, "Alert: File ends inside P3DData!\n");
+        return 1;
+    }
 
     #ifdef _DEBUG          
     printf("Debug: nPoints: %d\n",  p3d->data.nPoints);
     printf("Debug: nNormals: %d\n", p3d->data.nFaceNormals);
     printf("Debug: nFaces: %d\n",   p3d->data.nFaces);
     #endif
+    return 0;
 }
 
 //=============================================================================
@@ -33,13 +40,14 @@ void ReadP3DData(FILE *file, struct P3D *p3d)
 void ReadP3DPoints(FILE *file, struct P3D *p3d, struct RVHeader *rvh)
 {
     int i;
+    int unused;
 
     p3d->point = (struct P3DPoint *)malloc(p3d->data.nPoints * sizeof(struct P3DPoint));
 
     switch (rvh->Signature)  
     {
         case SP3X_SIGNATURE:   
-            fseek(file, 4, SEEK_CUR); //Skip unused data
+            fread(&unused, sizeof(unused), 1, file); //Skip unused data, read so pipes work too
             fread(p3d->point, sizeof(struct P3DPoint), p3d->data.nPoints, file);
             #ifdef _DEBUG
             for (i = 0; i < p3d->data.nPoints; i++)
@@ -116,13 +124,16 @@ void ReadP3DLodFaces(FILE *file, struct P3D *p3d, struct RVHeader *rvh)
                    p3d->lodface[i].FaceFlags);
             #endif
         }
-        #ifdef _DEBUG
         else
         {
-           printf("Debug: LodFace [%d]: TextureName=%s, FaceType=%d\n", i, 
+            p3d->lodface[i].FaceFlags = 0; //SP3D has none, -faceflags and -mvalue must not see heap garbage
+            #ifdef _DEBUG
+            printf("Debug: LodFace [%d]: TextureName=%s, FaceType=%d\n", i, 
                    p3d->lodface[i].TextureName, 
                    p3d->lodface[i].FaceType);    
+            #endif
         }
+        #ifdef _DEBUG
         for (j = 0; j < 4; j++) 
         {
             printf("  VertexTable [%d]: PointsIndex=%d, NormalsIndex=%d, U=%f, V=%f\n",
@@ -138,7 +149,7 @@ void ReadP3DLodFaces(FILE *file, struct P3D *p3d, struct RVHeader *rvh)
 
 //=================================Optional===================================
 
-void ReadP3DSupplement(FILE *file, struct P3D *p3d, struct RVHeader *rvh)
+int ReadP3DSupplement(FILE *file, struct P3D *p3d, struct RVHeader *rvh)
 {
     #ifdef _DEBUG
     int i;  
@@ -150,7 +161,7 @@ void ReadP3DSupplement(FILE *file, struct P3D *p3d, struct RVHeader *rvh)
     if (rvh->Signature != SS3D_SIGNATURE)
     {
         fprintf(stderr, "Alert: Wrong signature! (0x%X instead of 'SS3D').\n", rvh->Signature);
-        exit(1);
+        return 1;
     }
 
     fread(&p3d->supply.nPoints, sizeof(int), 1, file);
@@ -158,6 +169,13 @@ void ReadP3DSupplement(FILE *file, struct P3D *p3d, struct RVHeader *rvh)
     fread(&p3d->supply.nNormals, sizeof(int), 1, file);
     fread(&p3d->supply.nBytes, sizeof(int), 1, file);
 
+    if (p3d->supply.nPoints < 0 || p3d->supply.nFaces < 0 || p3d->supply.nNormals < 0 || p3d->supply.nBytes < 0 ||
+        CheckSectionSize(file, (double)p3d->supply.nPoints + p3d->supply.nFaces + p3d->supply.nNormals + p3d->supply.nBytes, "SS3D"))
+    {
+        fprintf(stderr, "Alert: Broken SS3D block!\n");
+        return 1;
+    }
+
     totalBools = p3d->supply.nPoints + p3d->supply.nFaces + p3d->supply.nNormals; //Check poseidon.h !!!
     p3d->supply.TinyBools = (unsigned char *)malloc(totalBools * sizeof(unsigned char));
     fread(p3d->supply.TinyBools, sizeof(unsigned char), totalBools, file);
@@ -181,68 +199,209 @@ void ReadP3DSupplement(FILE *file, struct P3D *p3d, struct RVHeader *rvh)
         printf("Debug: Indexes[%d]: %d\n", i, p3d->supply.Indexes[i]);
     }
     #endif
+    return 0;
 }
 
 //=================================Optional=END===============================
+
+void WriteSP3XFile(FILE *file, struct P3D *p3d)
+{
+    int signature = SP3X_SIGNATURE;
+    int major = MAJOR_VERSION;
+    int minor = MINOR_VERSION;
+    int unused = 0;
+    int totalBools;
+    int i;
+
+    fwrite(&signature, sizeof(int), 1, file);
+    fwrite(&major, sizeof(int), 1, file);
+    fwrite(&minor, sizeof(int), 1, file);
+    fwrite(&p3d->data, sizeof(struct P3DData), 1, file);
+
+    fwrite(&unused, sizeof(int), 1, file); //Mirrors the skip in ReadP3DPoints
+    fwrite(p3d->point, sizeof(struct P3DPoint), p3d->data.nPoints, file);
+    fwrite(p3d->triplet, sizeof(struct P3DTriplet), p3d->data.nFaceNormals, file);
+    fwrite(p3d->lodface, sizeof(struct P3DLodFace), p3d->data.nFaces, file);
+
+    signature = SS3D_SIGNATURE;
+    totalBools = p3d->data.nPoints + p3d->data.nFaces + p3d->data.nFaceNormals; //Check poseidon.h !!!
+
+    fwrite(&signature, sizeof(int), 1, file);
+    fwrite(&p3d->data.nPoints, sizeof(int), 1, file);
+    fwrite(&p3d->data.nFaces, sizeof(int), 1, file);
+    fwrite(&p3d->data.nFaceNormals, sizeof(int), 1, file);
+    if (p3d->supply.TinyBools && p3d->supply.nPoints == p3d->data.nPoints && 
+        p3d->supply.nFaces == p3d->data.nFaces && p3d->supply.nNormals == p3d->data.nFaceNormals)
+    {
+        fwrite(&p3d->supply.nBytes, sizeof(int), 1, file);
+        fwrite(p3d->supply.TinyBools, sizeof(unsigned char), totalBools, file);
+        if (p3d->supply.Indexes)
+        {
+            fwrite(p3d->supply.Indexes, sizeof(int), p3d->supply.nBytes / 4, file);
+        }
+    }
+    else //Nothing selected, nothing hidden
+    {
+        unused = 0;
+        fwrite(&unused, sizeof(int), 1, file);
+        for (i = 0; i < totalBools; i++)
+        {
+            fputc(0, file);
+        }
+    }
+}
+
+//============================================================================
 // WRP/WVR - World map format
 //============================================================================
 
-void ReadWVRTexture(FILE *file, struct WVR *wvr)
+int ReadWVRTexture(FILE *file, struct WVR *wvr, struct RVHeader *rvh)
 {
-    #ifdef _DEBUG
-    int i;  
-    #endif  
+    size_t count;
+    int    i;
 
-    fread(wvr->texture.Elevations, sizeof(wvr->texture.Elevations), 1, file);
-    fread(wvr->texture.TextureIndex, sizeof(wvr->texture.TextureIndex), 1, file);
-    fread(wvr->texture.TextureName, sizeof(wvr->texture.TextureName), 1, file);
+    if (rvh->Unknown < 2 || rvh->Unknown > HEIGHTMAP_MAX_SIZE || rvh->Unknown1 < 2 || rvh->Unknown1 > HEIGHTMAP_MAX_SIZE)
+    {
+        fprintf(stderr, "Alert: Wrong map size! (%d x %d).\n", rvh->Unknown, rvh->Unknown1);
+        return 1;
+    }
+    wvr->texture.Width = rvh->Unknown;
+    wvr->texture.Height = rvh->Unknown1;
+    count = (size_t)wvr->texture.Width * wvr->texture.Height;
+    if (CheckSectionSize(file, 2.0 * count * sizeof(short) + sizeof(wvr->texture.TextureName), "Map terrain"))
+    {
+        return 1;
+    }
+
+    wvr->texture.Elevations = (short *)malloc(count * sizeof(short));
+    wvr->texture.TextureIndex = (short *)malloc(count * sizeof(short));
+    if (!wvr->texture.Elevations || !wvr->texture.TextureIndex)
+    {
+        fprintf(stderr, "Alert: Out of memory for a %d x %d map!\n", wvr->texture.Width, wvr->texture.Height);
+        return 1;
+    }
+
+    if (fread(wvr->texture.Elevations, sizeof(short), count, file) != count ||
+        fread(wvr->texture.TextureIndex, sizeof(short), count, file) != count ||
+        fread(wvr->texture.TextureName, sizeof(wvr->texture.TextureName), 1, file) != 1)
+    {
+        fprintf(stderr, "Alert: Map terrain is truncated!\n");
+        return 1;
+    }
+    for (i = 0; i < 256; i++)
+    {
+        wvr->texture.TextureName[i][sizeof(wvr->texture.TextureName[i]) - 1] = '\0';
+    }
 
     #ifdef _DEBUG
+    printf("Debug: Map size: %d x %d\n", wvr->texture.Width, wvr->texture.Height);
     for (i = 0; i < 256; i++)
     {
         printf("Debug: Texture[%d]: %s\n", i, wvr->texture.TextureName[i]);
     }
-    #endif    
+    #endif
+    return 0;
 }
 
 //=============================================================================
+// 1WVR does not store how many placements there are, the table simply ends
+// where the nets begin. Every placement names a .p3d while a net header
+// starts with its texture name, so the first record that names no model is
+// the first net.
 
-void ReadWVRModels(FILE *file, struct WVR *wvr)
+int IsWVRModel(const struct WVRModel *model)
 {
-    #ifdef _DEBUG
-    int i;  
-    #endif  
-    
-    wvr->model = (struct WVRModel *)malloc(2233 * sizeof(struct WVRModel));
-    fread(wvr->model, sizeof(struct WVRModel), 2233, file);
+    const char *name = model->ModelName;
+    size_t     length = 0;
+    int        i;
+
+    while (length < sizeof(model->ModelName) && name[length])
+    {
+        length++;
+    }
+    if (length < 4 || length == sizeof(model->ModelName)) //Not terminated, no model name
+    {
+        return 0;
+    }
+    for (i = 0; i < 4; i++)
+    {
+        char c = name[length - 4 + i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        if (c != ".p3d"[i]) return 0;
+    }
+    return 1;
+}
+
+//=============================================================================
+
+int ReadWVRModels(FILE *file, struct WVR *wvr)
+{
+    struct WVRModel model;
+    int             capModels = 0;
+
+    wvr->nModels = 0;
+    while (1) //The first record without a model name is the first net header, it is read again by ReadWVRNet
+    {
+        if (fread(&model, sizeof(struct WVRModel), 1, file) != 1)
+        {
+            fprintf(stderr, "Alert: Map placements are truncated, no nets after %d models!\n", wvr->nModels);
+            return 1;
+        }
+        if (!IsWVRModel(&model))
+        {
+            break;
+        }
+        wvr->model = (struct WVRModel *)GrowArray(wvr->model, &capModels, wvr->nModels + 1, sizeof(struct WVRModel));
+        if (!wvr->model)
+        {
+            fprintf(stderr, "Alert: Out of memory for %d map placements!\n", wvr->nModels + 1);
+            return 1;
+        }
+        wvr->model[wvr->nModels++] = model;
+    }
+    if (fseek(file, -(long)sizeof(struct WVRModel), SEEK_CUR) != 0)
+    {
+        fprintf(stderr, "Alert: Maps have to be read from a file, not a stream!\n");
+        return 1;
+    }
 
     #ifdef _DEBUG
-    for (i = 0; i < 2233; i++)
     {
-        printf("Debug: Model[%d]: Position=(%f, %f, %f), Heading=%f, ModelName=%s\n",
-               i,
-               wvr->model[i].position.XYZ[0], 
-               wvr->model[i].position.XYZ[1], 
-               wvr->model[i].position.XYZ[2],
-               wvr->model[i].Heading,
-               wvr->model[i].ModelName);
+        int i;
+
+        printf("Debug: Models: %d\n", wvr->nModels);
+        for (i = 0; i < wvr->nModels; i++)
+        {
+            printf("Debug: Model[%d]: Position=(%f, %f, %f), Heading=%f, ModelName=%s\n",
+                   i,
+                   wvr->model[i].position.XYZ[0], 
+                   wvr->model[i].position.XYZ[1], 
+                   wvr->model[i].position.XYZ[2],
+                   wvr->model[i].Heading,
+                   wvr->model[i].ModelName);
+        }
     }
     #endif
-   //0x34E4C
+    return 0;
 }
 
 //=============================================================================
 
-void ReadWVRNet(FILE *file, struct WVR *wvr)
+int ReadWVRNet(FILE *file, struct WVR *wvr)
 {
     int nNets = 0;
     int nSubNets = 0;
     
     wvr->net.subnet = (struct WVRSubNet *)malloc(nSubNets * sizeof(struct WVRSubNet));
 
-    while (1)
+    while (1) //Only "EndOfNets" or the end of the file stop this, so every read is checked
     {
-        fread(&wvr->net.netheader, sizeof(struct WVRNetHeader), 1, file); 
+        if (fread(&wvr->net.netheader, sizeof(struct WVRNetHeader), 1, file) != 1)
+        {
+            fprintf(stderr, "Alert: Map nets are truncated, no EndOfNets after %d nets!\n", nNets);
+            return 1;
+        }
+        wvr->net.netheader.NetName[sizeof(wvr->net.netheader.NetName) - 1] = '\0';
 
         if (strcmp(wvr->net.netheader.NetName, "EndOfNets") == 0)
         {
@@ -252,7 +411,7 @@ void ReadWVRNet(FILE *file, struct WVR *wvr)
         #ifdef _DEBUG
         printf("Debug: Net[%d]:\n", nNets);
         printf("  Texture: %s\n", wvr->net.netheader.NetName);
-        printf("  Type: %ld\n", wvr->net.netheader.Type);
+        printf("  Type: %d\n", wvr->net.netheader.Type);
         printf("  Position: (%f, %f, %f)\n", wvr->net.netheader.position.XYZ[0], 
                                              wvr->net.netheader.position.XYZ[1], 
                                              wvr->net.netheader.position.XYZ[2]);
@@ -261,7 +420,11 @@ void ReadWVRNet(FILE *file, struct WVR *wvr)
 
         while (1)
         {
-            fread(&wvr->subnet, sizeof(struct WVRSubNet), 1, file);
+            if (fread(&wvr->subnet, sizeof(struct WVRSubNet), 1, file) != 1)
+            {
+                fprintf(stderr, "Alert: Map nets are truncated in net %d!\n", nNets);
+                return 1;
+            }
 
             if (wvr->subnet.X == 0.0 && wvr->subnet.Y == 0.0)
             {
@@ -279,4 +442,5 @@ void ReadWVRNet(FILE *file, struct WVR *wvr)
         }
         nNets++;
     }
+    return 0;
 }
\ No newline at end of file
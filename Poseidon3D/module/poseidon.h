@@ -6,7 +6,7 @@
 // DATA SIGNS
 //=============================================================================
 
-#define HEIGHTMAP_SIZE 128
+#define HEIGHTMAP_MAX_SIZE 4096 //Largest Xsize/Ysize we accept, 1WVR maps are 128
 
 //=============================================================================
 // FACE FLAGS
@@ -32,7 +32,13 @@
 // PROTOTYPING
 //=============================================================================
 
-void ReadP3DData(FILE *file, struct P3D *p3d);
+struct P3D;
+struct WVR;
+struct WVRModel;
+
+//=============================================================================
+
+int ReadP3DData(FILE *file, struct P3D *p3d);
 
 //=============================================================================
 
@@ -48,19 +54,27 @@ void ReadP3DLodFaces(FILE *file, struct P3D *p3d, struct RVHeader *rvh);
 
 //=============================================================================
 
-void ReadP3DSupplement(FILE *file, struct P3D *p3d, struct RVHeader *rvh);
+int ReadP3DSupplement(FILE *file, struct P3D *p3d, struct RVHeader *rvh);
+
+//=============================================================================
+
+void WriteSP3XFile(FILE *file, struct P3D *p3d);
+
+//=============================================================================
+
+int ReadWVRTexture(FILE *file, struct WVR *wvr, struct RVHeader *rvh);
 
 //=============================================================================
 
-void ReadWVRTexture(FILE *file, struct WVR *wvr);
+int IsWVRModel(const struct WVRModel *model);
 
 //=============================================================================
 
-void ReadWVRModels(FILE *file, struct WVR *wvr);
+int ReadWVRModels(FILE *file, struct WVR *wvr);
 
 //=============================================================================
 
-void ReadWVRNet(FILE *file, struct WVR *wvr);
+int ReadWVRNet(FILE *file, struct WVR *wvr);
 
 //=============================================================================
 // EXTERNING
@@ -161,8 +175,10 @@ struct WVRHeader //Deprecated, see header.h
 
 struct WVRTexture
 {
-    short Elevations[128][128];   // in centimetres. see 4WVR documentation
-    short TextureIndex[128][128]; // Each 'index' refers to a filename below. Range 0..255 4WVR is 1..511
+    int   Width;                  //Xsize and Ysize of the header
+    int   Height;
+    short *Elevations;            //Width * Height, row major, in centimetres. see 4WVR documentation
+    short *TextureIndex;          //Width * Height, each 'index' refers to a filename below. Range 0..255 4WVR is 1..511
     char  TextureName[256][32];   //"LandText\\mo.pac\0LandText.pi.pac.........."
 };
 
@@ -180,12 +196,12 @@ struct WVRModel //64 byte structure
 struct WVRNetHeader
 {
     char     NetName[24];         //"LandText\Silnice.pac" null termed
-    long     Unknown;             //0x00cd9100 or 0x00d4c600
-    long     Unknown1;            //0x00bfd400
-    long     Unknown2;            //0x00000047
-    long     Unknown3;            //0x00000000
-    long     Unknown4;            //0x0069fbb0;
-    long     Type;                //0,1 or 2
+    int      Unknown;             //0x00cd9100 or 0x00d4c600, int: 32 bit on disk, long is 64 bit on Linux
+    int      Unknown1;            //0x00bfd400
+    int      Unknown2;            //0x00000047
+    int      Unknown3;            //0x00000000
+    int      Unknown4;            //0x0069fbb0;
+    int      Type;                //0,1 or 2
     struct   P3DTriplet position; //[0.152,0.15,0.1] typical
     float    Scale;               //3.5, 4.5 or 5.5
 };
@@ -199,8 +215,8 @@ struct WVRSubNet
     {
         struct P3DTriplet position; // Very similar content to header triplet
         float             Stepping;
-        unsigned long     Unknown;  // 0x0046931A
-        unsigned long     Unknown1; // 0x00980778 or 0x733760
+        unsigned int      Unknown;  // 0x0046931A
+        unsigned int      Unknown1; // 0x00980778 or 0x733760
     } OptionalData;                 // Included only if X || Y
 };
 
@@ -221,6 +237,7 @@ struct WVR
     struct WVRNet       net;
     struct WVRSubNet    subnet;
     struct WVRModel     *model;
+    int                 nModels;
 };
 
 #endif // POSEIDON_H
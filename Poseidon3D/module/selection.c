@@ -0,0 +1,212 @@
+//=============================================================================
+//
+//  Module:         Selection - partial export of a model
+//
+//  Author:         GameSpy
+//
+//  Date:           Started 19.10.2026
+//
+//=============================================================================
+// Faces that pass the filter are moved to the front of the face table in
+// file order. Points and normals are renumbered in the order the kept faces
+// first use them, in one pass over the kept faces, so nothing outside the
+// subset is ever copied. The SS3D bools are carried over for the kept
+// entries, so an SP3X written afterwards keeps its selection.
+//=============================================================================
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "selection.h"
+#include "validate.h"
+
+//=============================================================================
+
+static int IsFaceSelected(struct P3D *p3d, int face)
+{
+    return p3d->supply.TinyBools[p3d->data.nPoints + face] != 0;
+}
+
+//=============================================================================
+// Oxygen also stores point only selections, where the face bools stay clear.
+
+static int ArePointsSelected(struct P3D *p3d, int face)
+{
+    struct P3DLodFace *lodface = &p3d->lodface[face];
+    int               i;
+
+    for (i = 0; i < ((lodface->FaceType == 3) ? 3 : 4); i++)
+    {
+        if (!p3d->supply.TinyBools[lodface->p3dvertextable[i].PointsIndex])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//=============================================================================
+
+static int IsFaceWanted(struct P3D *p3d, const struct SelectionFilter *filter, int face)
+{
+    unsigned long flags = (unsigned long)(unsigned int)p3d->lodface[face].FaceFlags;
+
+    if (filter->FaceFlags && !(flags & filter->FaceFlags))
+    {
+        return 0;
+    }
+    if (filter->UseMValue && (int)((flags & USER_MVALUE) >> MVALUE_SHIFT) != filter->MValue)
+    {
+        return 0;
+    }
+    if (filter->Selected && !IsFaceSelected(p3d, face))
+    {
+        return 0;
+    }
+    if (filter->SelectedPoints && !ArePointsSelected(p3d, face))
+    {
+        return 0;
+    }
+    return 1;
+}
+
+//=============================================================================
+// Returns 0 with the model reduced to the faces the filter lets through.
+
+int ExtractSelection(struct P3D *p3d, const struct SelectionFilter *filter)
+{
+    struct P3DPoint   *point = NULL;
+    struct P3DTriplet *triplet = NULL;
+    unsigned char     *bools = NULL;
+    int               *pointMap;   //Old index -> new index + 1, 0 = not used yet
+    int               *normalMap;
+    int               nPoints = 0, nNormals = 0, nFaces = 0;
+    int               maxCorners;
+    int               hasBools;
+    int               i,k;
+
+    if (!filter->Selected && !filter->SelectedPoints && !filter->FaceFlags && !filter->UseMValue)
+    {
+        return 0;
+    }
+
+    if (ValidateP3DFaces(p3d, 0)) //The renumbering below indexes with every corner, OBJ input got no check yet
+    {
+        return 1;
+    }
+
+    hasBools = p3d->supply.TinyBools && p3d->supply.nPoints == p3d->data.nPoints &&
+               p3d->supply.nFaces == p3d->data.nFaces && p3d->supply.nNormals == p3d->data.nFaceNormals;
+    if ((filter->Selected || filter->SelectedPoints) && !hasBools)
+    {
+        fprintf(stderr, "Alert: Model has no SS3D selection!\n");
+        return 1;
+    }
+
+    //calloc hands back untouched zero pages, only the entries the subset uses are ever written
+    pointMap = (int *)calloc(p3d->data.nPoints + 1, sizeof(int));
+    normalMap = (int *)calloc(p3d->data.nFaceNormals + 1, sizeof(int));
+    if (!pointMap || !normalMap)
+    {
+        free(pointMap);
+        free(normalMap);
+        return 1;
+    }
+
+    for (i = 0; i < p3d->data.nFaces; i++)
+    {
+        if (IsFaceWanted(p3d, filter, i))
+        {
+            if (hasBools) //Same in place move for the face bools, they are read again below
+            {
+                p3d->supply.TinyBools[p3d->data.nPoints + nFaces] = p3d->supply.TinyBools[p3d->data.nPoints + i];
+            }
+            p3d->lodface[nFaces++] = p3d->lodface[i]; //Never overtakes i, so the face table compacts in place
+        }
+    }
+
+    if (nFaces == 0)
+    {
+        fprintf(stderr, "Alert: No faces left after selection!\n");
+        free(pointMap);
+        free(normalMap);
+        return 1;
+    }
+
+    maxCorners = nFaces * 4;
+    point = (struct P3DPoint *)malloc(((maxCorners < p3d->data.nPoints) ? maxCorners : p3d->data.nPoints) * sizeof(struct P3DPoint));
+    triplet = (struct P3DTriplet *)malloc(((maxCorners < p3d->data.nFaceNormals) ? maxCorners : p3d->data.nFaceNormals) * sizeof(struct P3DTriplet));
+    if (hasBools)
+    {
+        bools = (unsigned char *)malloc(nFaces + 2 * maxCorners);
+    }
+    if (!point || !triplet || (hasBools && !bools))
+    {
+        free(point);
+        free(triplet);
+        free(bools);
+        free(pointMap);
+        free(normalMap);
+        return 1;
+    }
+
+    for (i = 0; i < nFaces; i++) //Renumber points and normals in first use order
+    {
+        struct P3DLodFace *face = &p3d->lodface[i];
+
+        for (k = 0; k < ((face->FaceType == 3) ? 3 : 4); k++)
+        {
+            struct P3DVertexTable *table = &face->p3dvertextable[k];
+
+            if (!pointMap[table->PointsIndex])
+            {
+                point[nPoints] = p3d->point[table->PointsIndex];
+                if (hasBools) bools[nPoints] = p3d->supply.TinyBools[table->PointsIndex];
+                pointMap[table->PointsIndex] = ++nPoints;
+            }
+            if (!normalMap[table->NormalsIndex])
+            {
+                triplet[nNormals] = p3d->triplet[table->NormalsIndex];
+                if (hasBools) bools[maxCorners + nNormals] = p3d->supply.TinyBools[p3d->data.nPoints + p3d->data.nFaces + table->NormalsIndex];
+                normalMap[table->NormalsIndex] = ++nNormals;
+            }
+            table->PointsIndex = pointMap[table->PointsIndex] - 1;
+            table->NormalsIndex = normalMap[table->NormalsIndex] - 1;
+        }
+    }
+
+    if (hasBools) //Points, faces, normals, see P3DSupplement
+    {
+        memmove(bools + nPoints + nFaces, bools + maxCorners, nNormals);
+        memcpy(bools + nPoints, p3d->supply.TinyBools + p3d->data.nPoints, nFaces);
+    }
+
+    #ifdef _DEBUG
+    printf("Debug: Selection: %d of %d faces, %d of %d points, %d of %d normals\n",
+           nFaces, p3d->data.nFaces, nPoints, p3d->data.nPoints, nNormals, p3d->data.nFaceNormals);
+    #endif
+
+    free(p3d->point);
+    free(p3d->triplet);
+    p3d->point = point;
+    p3d->triplet = triplet;
+    p3d->data.nPoints = nPoints;
+    p3d->data.nFaceNormals = nNormals;
+    p3d->data.nFaces = nFaces;
+
+    if (hasBools)
+    {
+        free(p3d->supply.TinyBools);
+        free(p3d->supply.Indexes);
+        p3d->supply.TinyBools = (char *)bools;
+        p3d->supply.Indexes = NULL;
+        p3d->supply.nPoints = nPoints;
+        p3d->supply.nFaces = nFaces;
+        p3d->supply.nNormals = nNormals;
+        p3d->supply.nBytes = 0; //The index block refers to the old numbering
+    }
+
+    free(pointMap);
+    free(normalMap);
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+#include "poseidon.h"
+
+//=============================================================================
+// DATA SIGNS
+//=============================================================================
+
+#define MVALUE_SHIFT 25 //USER_MVALUE sits in the top 7 bits of FaceFlags
+
+//=============================================================================
+// PROTOTYPING
+//=============================================================================
+
+struct SelectionFilter;
+
+//=============================================================================
+
+int ExtractSelection(struct P3D *p3d, const struct SelectionFilter *filter);
+
+//=============================================================================
+// EXTERNING
+//=============================================================================
+
+//=============================================================================
+// Face filter, every rule that is switched on must match
+//=============================================================================
+
+struct SelectionFilter
+{
+    int           Selected;       //Face is selected in SS3D
+    int           SelectedPoints; //All points of the face are selected in SS3D
+    unsigned long FaceFlags;      //Face has any of these FaceFlags bits set, 0 = off
+    int           UseMValue;
+    int           MValue;         //USER_MVALUE of the face, 0..127
+};
+
+#endif // SELECTION_H
@@ -0,0 +1,552 @@
+//=============================================================================
+//
+//  Module:         Terrain - tiled heightmap export with quadtree LOD
+//
+//  Author:         GameSpy
+//
+//  Date:           Started 19.10.2026
+//
+//=============================================================================
+// The grid is split by a quadtree until a node fits TERRAIN_TILE_SIZE, every
+// leaf is one tile. Each tile is written once per LOD as its own OBJ, every
+// interior node gets one mesh at the next coarser LOD, so a far away area is
+// drawn from one parent instead of four children. Meshes have a skirt hanging
+// off the border so neighbours at different LODs leave no cracks.
+// "<prefix>.qtree" lists the nodes with their height bounds and meshes, so a
+// viewer can cull and stream tiles without opening them. Textured tiles use
+// "<prefix>.mtl", every cell gets the material of its texture repeated once.
+//=============================================================================
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "terrain.h"
+#include "poseidon.h"
+#include "thread.h"
+#include "texture.h"
+#include "common.h"
+
+#define TERRAIN_NAME_SIZE 64 //Room for "_<x>_<y>_lod<n>.obj.tmp" behind the prefix
+
+struct TerrainMesh
+{
+    int Node;
+    int Lod;
+};
+
+struct TerrainBuild
+{
+    const struct TerrainGrid *grid;
+    const char               *prefix;
+    char                     *mtllib;  //"<name>.mtl" relative to the tiles, NULL if untextured
+    struct TerrainNode       *node;
+    int                      nNodes, capNodes;
+    struct TerrainMesh       *mesh;    //One per LOD of every leaf, one per interior node
+    int                      nMeshes, capMeshes;
+    int                      nTiles;
+    int                      failed;
+};
+
+//=============================================================================
+
+static short GetHeight(const struct TerrainGrid *grid, int x, int y)
+{
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x > grid->Width - 1)  x = grid->Width - 1;
+    if (y > grid->Height - 1) y = grid->Height - 1;
+    return grid->Elevations[y * grid->Width + x];
+}
+
+//=============================================================================
+// Material of the cell whose first corner is (x, y), -1 for none.
+
+static int GetMaterial(const struct TerrainGrid *grid, int x, int y)
+{
+    int index = grid->TextureIndex[y * grid->Width + x];
+
+    return (index >= 0 && index < 256 && grid->TextureName[index][0]) ? index : -1;
+}
+
+//=============================================================================
+
+static void AddMesh(struct TerrainBuild *build, int node, int lod)
+{
+    struct TerrainMesh *mesh = (struct TerrainMesh *)GrowArray(build->mesh, &build->capMeshes, build->nMeshes + 1, sizeof(struct TerrainMesh));
+
+    if (!mesh)
+    {
+        build->failed = 1;
+        return;
+    }
+    build->mesh = mesh;
+    build->mesh[build->nMeshes].Node = node;
+    build->mesh[build->nMeshes].Lod = lod;
+    build->nMeshes++;
+}
+
+//=============================================================================
+
+static int BuildNode(struct TerrainBuild *build, int x, int y, int size)
+{
+    const struct TerrainGrid *grid = build->grid;
+    struct TerrainNode       *node;
+    int                      index;
+    int                      i,j;
+
+    if (x >= grid->Width - 1 || y >= grid->Height - 1) //Outside the grid, the root is rounded up to a power of two
+    {
+        return -1;
+    }
+
+    node = (struct TerrainNode *)GrowArray(build->node, &build->capNodes, build->nNodes + 1, sizeof(struct TerrainNode));
+    if (!node)
+    {
+        build->failed = 1;
+        return -1;
+    }
+    build->node = node;
+    index = build->nNodes++;
+    node = &build->node[index];
+    node->X = x;
+    node->Y = y;
+    node->Size = size;
+
+    if (size <= TERRAIN_TILE_SIZE)
+    {
+        int x1 = (x + size < grid->Width - 1)  ? x + size : grid->Width - 1;
+        int y1 = (y + size < grid->Height - 1) ? y + size : grid->Height - 1;
+
+        node->MinHeight = node->MaxHeight = GetHeight(grid, x, y);
+        for (j = y; j <= y1; j++)
+        {
+            for (i = x; i <= x1; i++)
+            {
+                short h = GetHeight(grid, i, j);
+                if (h < node->MinHeight) node->MinHeight = h;
+                if (h > node->MaxHeight) node->MaxHeight = h;
+            }
+        }
+        for (i = 0; i < 4; i++) node->Child[i] = -1;
+        node->Lod = TERRAIN_LODS - 1;
+
+        for (i = 0; i < TERRAIN_LODS; i++) AddMesh(build, index, i);
+        build->nTiles++;
+        return index;
+    }
+
+    {
+        int   half = size / 2;
+        int   child[4];
+        short minh = 0x7FFF;
+        short maxh = -0x7FFF - 1;
+
+        child[0] = BuildNode(build, x,        y,        half);
+        child[1] = BuildNode(build, x + half, y,        half);
+        child[2] = BuildNode(build, x,        y + half, half);
+        child[3] = BuildNode(build, x + half, y + half, half);
+
+        node = &build->node[index]; //The array may have moved
+        for (i = 0; i < 4; i++)
+        {
+            node->Child[i] = child[i];
+            if (child[i] < 0) continue;
+            if (build->node[child[i]].MinHeight < minh) minh = build->node[child[i]].MinHeight;
+            if (build->node[child[i]].MaxHeight > maxh) maxh = build->node[child[i]].MaxHeight;
+        }
+        node->MinHeight = minh;
+        node->MaxHeight = maxh;
+        node->Lod = (child[0] >= 0) ? build->node[child[0]].Lod + 1 : TERRAIN_LODS; //Child 0 starts at our corner, it always exists
+
+        AddMesh(build, index, node->Lod);
+    }
+    return index;
+}
+
+//=============================================================================
+// Sample positions along one tile side, the last sample is always the border
+// so neighbouring tiles share their edge vertices at every LOD.
+
+static int GetSamples(int first, int last, int step, int *sample)
+{
+    int count = 0;
+    int i;
+
+    for (i = first; i < last; i += step)
+    {
+        sample[count++] = i;
+    }
+    sample[count++] = last;
+    return count;
+}
+
+//=============================================================================
+// Untextured tiles stretch one UV square over the whole map, textured ones
+// count in cells so every cell shows its texture once.
+
+static void WriteTexCoord(FILE *file, const struct TerrainGrid *grid, int textured, int x, int y)
+{
+    if (textured)
+    {
+        fprintf(file, "vt %f %f\n", (float)x, (float)y);
+    }
+    else
+    {
+        fprintf(file, "vt %f %f\n", (float)x / (grid->Width - 1), (float)y / (grid->Height - 1));
+    }
+}
+
+//=============================================================================
+// Cells without a texture keep whatever material came before them.
+
+static void SetMaterial(FILE *file, const struct TerrainGrid *grid, int index, int *current)
+{
+    if (index >= 0 && index != *current)
+    {
+        fprintf(file, "usemtl %s\n", grid->TextureName[index]);
+        *current = index;
+    }
+}
+
+//=============================================================================
+// "<prefix>_<x>_<y>_lod<n>.obj", x and y count nodes of this size, so leaves
+// are numbered by tile and every LOD above them halves the numbers.
+
+static void WriteMesh(void *context, int index)
+{
+    struct TerrainBuild      *build = (struct TerrainBuild *)context;
+    const struct TerrainGrid *grid = build->grid;
+    struct TerrainNode       *node = &build->node[build->mesh[index].Node];
+    int                      lod = build->mesh[index].Lod;
+    int                      step = 1 << lod;
+    int                      xs[TERRAIN_TILE_SIZE + 2]; //Interior nodes sample as coarse as the coarsest leaf LOD
+    int                      ys[TERRAIN_TILE_SIZE + 2];
+    int                      *ring;
+    int                      nx, ny, nRing;
+    int                      i,j;
+    int                      material = -1;
+    int                      failed;
+    float                    skirt = step * grid->CellSize * 0.5f;
+    char                     *path;
+    char                     *temp;
+    FILE                     *file = NULL;
+
+    nx = GetSamples(node->X, (node->X + node->Size < grid->Width - 1)  ? node->X + node->Size : grid->Width - 1,  step, xs);
+    ny = GetSamples(node->Y, (node->Y + node->Size < grid->Height - 1) ? node->Y + node->Size : grid->Height - 1, step, ys);
+
+    path = (char *)malloc(strlen(build->prefix) + TERRAIN_NAME_SIZE);
+    temp = (char *)malloc(strlen(build->prefix) + TERRAIN_NAME_SIZE);
+    if (path && temp)
+    {
+        sprintf(path, "%s_%d_%d_lod%d.obj", build->prefix, node->X / node->Size, node->Y / node->Size, lod);
+        sprintf(temp, "%s.tmp", path);
+        file = fopen(temp, "w");
+    }
+    ring = (int *)malloc(2 * (nx + ny) * sizeof(int));
+    if (!file || !ring)
+    {
+        if (file) { fclose(file); remove(temp); }
+        free(ring);
+        free(path);
+        free(temp);
+        build->failed = 1;
+        return;
+    }
+
+    //Border loop: +X along the first row, +Y down the last column, back -X and -Y
+    nRing = 0;
+    for (i = 0; i < nx - 1; i++)  ring[nRing++] = i;
+    for (j = 0; j < ny - 1; j++)  ring[nRing++] = j * nx + nx - 1;
+    for (i = nx - 1; i > 0; i--)  ring[nRing++] = (ny - 1) * nx + i;
+    for (j = ny - 1; j > 0; j--)  ring[nRing++] = j * nx;
+
+    if (build->mtllib)
+    {
+        fprintf(file, "mtllib %s\n", build->mtllib);
+    }
+    for (j = 0; j < ny; j++)
+    {
+        for (i = 0; i < nx; i++)
+        {
+            int   x = xs[i], y = ys[j];
+            float dx = (GetHeight(grid, x + step, y) - GetHeight(grid, x - step, y)) / (200.0f * step * grid->CellSize);
+            float dy = (GetHeight(grid, x, y + step) - GetHeight(grid, x, y - step)) / (200.0f * step * grid->CellSize);
+            float length = (float)sqrt(dx * dx + 1.0f + dy * dy);
+
+            fprintf(file, "v %f %f %f\n", x * grid->CellSize, GetHeight(grid, x, y) / 100.0f, y * grid->CellSize);
+            WriteTexCoord(file, grid, build->mtllib != NULL, x, y);
+            fprintf(file, "vn %f %f %f\n", -dx / length, 1.0f / length, -dy / length);
+        }
+    }
+    for (i = 0; i < nRing; i++) //Skirt vertices, straight below the border
+    {
+        int x = xs[ring[i] % nx], y = ys[ring[i] / nx];
+
+        fprintf(file, "v %f %f %f\n", x * grid->CellSize, GetHeight(grid, x, y) / 100.0f - skirt, y * grid->CellSize);
+        WriteTexCoord(file, grid, build->mtllib != NULL, x, y);
+    }
+
+    for (j = 0; j < ny - 1; j++)
+    {
+        for (i = 0; i < nx - 1; i++)
+        {
+            int v00 = j * nx + i + 1;
+            int v01 = v00 + 1;
+            int v10 = v00 + nx;
+            int v11 = v10 + 1;
+
+            if (build->mtllib)
+            {
+                SetMaterial(file, grid, GetMaterial(grid, xs[i], ys[j]), &material);
+            }
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", v00,v00,v00, v10,v10,v10, v01,v01,v01);
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", v01,v01,v01, v10,v10,v10, v11,v11,v11);
+        }
+    }
+    for (i = 0; i < nRing; i++) //Skirts share the normal of the border vertex they hang from
+    {
+        int a = ring[i] + 1;
+        int b = ring[(i + 1) % nRing] + 1;
+        int sa = nx * ny + i + 1;
+        int sb = nx * ny + (i + 1) % nRing + 1;
+
+        if (build->mtllib)
+        {
+            SetMaterial(file, grid, GetMaterial(grid, xs[ring[i] % nx], ys[ring[i] / nx]), &material);
+        }
+        fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a,a,a, b,b,b, sb,sb,b, sa,sa,a);
+    }
+
+    failed = ferror(file);
+    if (fclose(file) != 0) failed = 1;
+    if (failed)
+    {
+        remove(temp);
+    }
+    else
+    {
+        failed = CommitTempFile(temp, path);
+    }
+    if (failed)
+    {
+        build->failed = 1;
+    }
+    free(ring);
+    free(path);
+    free(temp);
+}
+
+//=============================================================================
+
+static void WriteQuadtree(struct TerrainBuild *build)
+{
+    const struct TerrainGrid *grid = build->grid;
+    char                     *path;
+    char                     *temp;
+    FILE                     *file = NULL;
+    int                      failed;
+    int                      i;
+
+    path = (char *)malloc(strlen(build->prefix) + TERRAIN_NAME_SIZE);
+    temp = (char *)malloc(strlen(build->prefix) + TERRAIN_NAME_SIZE);
+    if (path && temp)
+    {
+        sprintf(path, "%s.qtree", build->prefix);
+        sprintf(temp, "%s.tmp", path);
+        file = fopen(temp, "w");
+    }
+    if (!file)
+    {
+        free(path);
+        free(temp);
+        build->failed = 1;
+        return;
+    }
+
+    fprintf(file, "# grid <width> <height> <cell_size> <tile_size> <lods>\n");
+    fprintf(file, "grid %d %d %f %d %d\n", grid->Width, grid->Height, grid->CellSize, TERRAIN_TILE_SIZE, TERRAIN_LODS);
+    fprintf(file, "# node <x> <y> <size> <min_cm> <max_cm> <child0> <child1> <child2> <child3> <mesh_x> <mesh_y> <lod_first> <lod_last>\n");
+    for (i = 0; i < build->nNodes; i++) //Node 0 is the root, children are listed by index
+    {
+        struct TerrainNode *node = &build->node[i];
+
+        fprintf(file, "node %d %d %d %d %d %d %d %d %d %d %d %d %d\n",
+                node->X, node->Y, node->Size,
+                node->MinHeight, node->MaxHeight,
+                node->Child[0], node->Child[1], node->Child[2], node->Child[3],
+                node->X / node->Size, node->Y / node->Size,
+                (node->Size <= TERRAIN_TILE_SIZE) ? 0 : node->Lod, node->Lod);
+    }
+
+    failed = ferror(file);
+    if (fclose(file) != 0) failed = 1;
+    if (failed)
+    {
+        remove(temp);
+    }
+    else
+    {
+        failed = CommitTempFile(temp, path);
+    }
+    if (failed)
+    {
+        build->failed = 1;
+    }
+    free(path);
+    free(temp);
+}
+
+//=============================================================================
+
+static void WriteMaterialLib(struct TerrainBuild *build)
+{
+    char *path;
+    char *temp;
+    char names[256][32];
+    FILE *file = NULL;
+    int  failed;
+
+    path = (char *)malloc(strlen(build->prefix) + TERRAIN_NAME_SIZE);
+    temp = (char *)malloc(strlen(build->prefix) + TERRAIN_NAME_SIZE);
+    if (path && temp)
+    {
+        sprintf(path, "%s.mtl", build->prefix);
+        sprintf(temp, "%s.tmp", path);
+        file = fopen(temp, "w");
+    }
+    if (!file)
+    {
+        free(path);
+        free(temp);
+        build->failed = 1;
+        return;
+    }
+
+    memcpy(names, build->grid->TextureName, sizeof(names)); //WriteMaterials sorts them
+    failed = WriteMaterials(file, names, 256);
+    if (fclose(file) != 0) failed = 1;
+    if (failed)
+    {
+        remove(temp);
+    }
+    else
+    {
+        failed = CommitTempFile(temp, path);
+    }
+    if (failed)
+    {
+        build->failed = 1;
+    }
+    free(path);
+    free(temp);
+}
+
+//=============================================================================
+
+int ExportTerrainTiles(const struct TerrainGrid *grid, const char *prefix)
+{
+    struct TerrainBuild build;
+    int                 size = 1;
+
+    if (grid->Width < 2 || grid->Height < 2)
+    {
+        fprintf(stderr, "Alert: Terrain grid is too small!\n");
+        return 1;
+    }
+
+    memset(&build, 0, sizeof(build));
+    build.grid = grid;
+    build.prefix = prefix;
+    if (grid->TextureIndex)
+    {
+        const char *name = prefix;
+        const char *p;
+
+        for (p = prefix; *p; p++) //Tiles sit next to the library, they name it without the folder
+        {
+            if (*p == '/' || *p == '\\') name = p + 1;
+        }
+        build.mtllib = (char *)malloc(strlen(name) + 5);
+        if (!build.mtllib)
+        {
+            fprintf(stderr, "Alert: Error writing terrain tiles <%s>!\n", prefix);
+            return 1;
+        }
+        sprintf(build.mtllib, "%s.mtl", name);
+    }
+
+    while (size < grid->Width - 1 || size < grid->Height - 1) size *= 2;
+    BuildNode(&build, 0, 0, size);
+
+    if (!build.failed) //Out of memory for the tree
+    {
+        ParallelFor(build.nMeshes, WriteMesh, &build);
+        WriteQuadtree(&build);
+        if (build.mtllib)
+        {
+            WriteMaterialLib(&build);
+        }
+    }
+
+    #ifdef _DEBUG
+    printf("Debug: Terrain nodes: %d\n", build.nNodes);
+    printf("Debug: Terrain tiles: %d x %d LODs\n", build.nTiles, TERRAIN_LODS);
+    printf("Debug: Terrain meshes: %d\n", build.nMeshes);
+    #endif
+
+    if (build.failed)
+    {
+        fprintf(stderr, "Alert: Error writing terrain tiles <%s>!\n", prefix);
+    }
+    free(build.node);
+    free(build.mesh);
+    free(build.mtllib);
+    return build.failed;
+}
+
+//=============================================================================
+// The map names 256 textures, usually only a few are on the ground. Unused
+// names are emptied, so they are neither decoded nor listed as materials.
+
+void GetTerrainTextures(const struct WVR *wvr, char (*names)[32])
+{
+    char used[256];
+    long count = (long)wvr->texture.Width * wvr->texture.Height;
+    long i;
+
+    memset(used, 0, sizeof(used));
+    for (i = 0; i < count; i++)
+    {
+        short index = wvr->texture.TextureIndex[i];
+        if (index >= 0 && index < 256) used[index] = 1;
+    }
+    for (i = 0; i < 256; i++)
+    {
+        memcpy(names[i], wvr->texture.TextureName[i], 32);
+        if (!used[i]) names[i][0] = '\0';
+    }
+}
+
+//=============================================================================
+
+int ExportWVRTerrain(struct WVR *wvr, const char *prefix, int textured)
+{
+    struct TerrainGrid grid;
+    char               names[256][32];
+
+    grid.Elevations = wvr->texture.Elevations;
+    grid.TextureIndex = NULL;
+    grid.TextureName = NULL;
+    grid.Width = wvr->texture.Width;
+    grid.Height = wvr->texture.Height;
+    grid.CellSize = TERRAIN_CELL_SIZE;
+    if (textured)
+    {
+        GetTerrainTextures(wvr, names);
+        grid.TextureIndex = wvr->texture.TextureIndex;
+        grid.TextureName = names;
+    }
+
+    return ExportTerrainTiles(&grid, prefix);
+}
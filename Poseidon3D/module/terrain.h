@@ -0,0 +1,59 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+//=============================================================================
+// DATA SIGNS
+//=============================================================================
+
+#define TERRAIN_TILE_SIZE 32    //Cells per tile side at LOD 0, power of two
+#define TERRAIN_LODS      3     //LOD n samples every (1 << n)th cell
+#define TERRAIN_CELL_SIZE 50.0f //Metres per cell, see WVRModel
+
+//=============================================================================
+// PROTOTYPING
+//=============================================================================
+
+struct TerrainGrid;
+struct WVR;
+
+//=============================================================================
+
+int ExportTerrainTiles(const struct TerrainGrid *grid, const char *prefix);
+
+//=============================================================================
+
+void GetTerrainTextures(const struct WVR *wvr, char (*names)[32]);
+
+//=============================================================================
+
+int ExportWVRTerrain(struct WVR *wvr, const char *prefix, int textured);
+
+//=============================================================================
+// EXTERNING
+//=============================================================================
+
+//=============================================================================
+
+struct TerrainGrid
+{
+    const short *Elevations;        //Row major, Width * Height samples, in centimetres
+    const short *TextureIndex;      //Same layout, into TextureName. NULL for untextured tiles
+    char        (*TextureName)[32]; //256 names, empty ones get no material
+    int         Width;
+    int         Height;
+    float       CellSize;
+};
+
+//=============================================================================
+
+struct TerrainNode
+{
+    int   X, Y;       //First sample
+    int   Size;       //Cells per side
+    short MinHeight;
+    short MaxHeight;
+    int   Child[4];   //-1 for leaves
+    int   Lod;        //LOD of the node mesh, leaves also have every finer one
+};
+
+#endif // TERRAIN_H
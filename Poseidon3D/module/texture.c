@@ -0,0 +1,832 @@
+//=============================================================================
+//
+//  Module:         Texture - PAC/PAA decoding for referenced textures
+//
+//  Credits:        https://community.bistudio.com/wiki/PAA_File_Format
+//
+//  Author:         GameSpy
+//
+//  Date:           Started 19.10.2026
+//
+//=============================================================================
+// Only the top mipmap is decoded and written as a 32 bit TGA. Every image is
+// decoded once per version of its source (size and content hash), no matter
+// how many models or requests use it; the registry is shared by all threads.
+// Missing or broken sources are reported and skipped, only output errors fail
+// a request.
+//=============================================================================
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "texture.h"
+#include "thread.h"
+#include "common.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_SSE2
+#include <emmintrin.h>
+#endif
+
+struct TextureJob
+{
+    const char *Name;
+    char       Image[40]; //GetTextureImageName of Name
+    const char *root;
+    const char *outdir;
+    int        failed;
+};
+
+struct TextureEntry
+{
+    char          *Target; //Output image path
+    Hash64        Hash;
+    int           State;
+    long          Size;    //Source the image was decoded from
+    Hash64        Source;  //HashBytes of it, the daemon keys its cache the same way
+    struct Signal *ready;  //Cleared while PENDING
+};
+
+static struct Lock         *CacheLock;
+static struct TextureEntry *Decoded;
+static int                 nDecoded, capDecoded;
+
+//=============================================================================
+
+void InitTextureCache(void)
+{
+    if (!CacheLock)
+    {
+        CacheLock = CreateLock();
+    }
+}
+
+//=============================================================================
+// Returns 0 if the image is already up to date, 1 if the caller has to
+// decode it. Then *entry is the claimed entry (or -1 without a registry),
+// to be handed to ReleaseTexture. A request that finds the image PENDING
+// waits for the decoder, so nobody answers before the image is written.
+
+static int ClaimTexture(const char *target, long size, Hash64 source, int *entry)
+{
+    Hash64        hash = HashString(FNV64_OFFSET, target);
+    struct Signal *ready;
+    struct stat   st;
+    int           i;
+
+    *entry = -1;
+    if (!CacheLock)
+    {
+        return 1;
+    }
+
+    while (1)
+    {
+        EnterLock(CacheLock);
+        for (i = 0; i < nDecoded; i++)
+        {
+            if (Decoded[i].Hash == hash && strcmp(Decoded[i].Target, target) == 0)
+            {
+                break;
+            }
+        }
+        if (i < nDecoded && Decoded[i].State == TEXTURE_PENDING)
+        {
+            ready = Decoded[i].ready;
+            LeaveLock(CacheLock);
+            WaitSignal(ready); //Returns once the decoder is done, then look again
+            continue;
+        }
+        if (i < nDecoded && Decoded[i].State == TEXTURE_DONE && Decoded[i].Size == size && Decoded[i].Source == source &&
+            stat(target, &st) == 0)
+        {
+            LeaveLock(CacheLock);
+            return 0;
+        }
+        break;
+    }
+
+    if (i == nDecoded) //New image, failed and stale ones are simply decoded again
+    {
+        if (nDecoded == capDecoded) //Not GrowArray, it forgets the capacity when it fails
+        {
+            int                 newcap = capDecoded ? capDecoded * 2 : 256;
+            struct TextureEntry *decoded = (struct TextureEntry *)realloc(Decoded, newcap * sizeof(struct TextureEntry));
+
+            if (!decoded) //Out of memory only costs a second decode
+            {
+                LeaveLock(CacheLock);
+                return 1;
+            }
+            Decoded = decoded;
+            capDecoded = newcap;
+        }
+        Decoded[i].Target = CopyString(target);
+        Decoded[i].Hash = hash;
+        Decoded[i].ready = CreateSignal();
+        if (!Decoded[i].Target || !Decoded[i].ready)
+        {
+            free(Decoded[i].Target);
+            DestroySignal(Decoded[i].ready);
+            LeaveLock(CacheLock);
+            return 1;
+        }
+        nDecoded++;
+    }
+    Decoded[i].State = TEXTURE_PENDING;
+    Decoded[i].Size = size;
+    Decoded[i].Source = source;
+    ClearSignal(Decoded[i].ready);
+    LeaveLock(CacheLock);
+
+    *entry = i;
+    return 1;
+}
+
+//=============================================================================
+
+static void ReleaseTexture(int entry, int failed)
+{
+    if (entry < 0)
+    {
+        return;
+    }
+    EnterLock(CacheLock);
+    Decoded[entry].State = failed ? TEXTURE_FAILED : TEXTURE_DONE;
+    RaiseSignal(Decoded[entry].ready); //Wakes everybody waiting for this image
+    LeaveLock(CacheLock);
+}
+
+//=============================================================================
+// BI flavoured LZSS: flag byte, LSB first, 1 = literal, 0 = 12 bit back
+// reference plus 4 bit length. References before the start read spaces.
+
+static int ReadLZSS(const unsigned char *in, long inSize, unsigned char *out, long outSize)
+{
+    long ip = 0;
+    long op = 0;
+    int  bit;
+
+    while (op < outSize)
+    {
+        int flags;
+
+        if (ip >= inSize) return 1;
+        flags = in[ip++];
+
+        for (bit = 0; bit < 8 && op < outSize; bit++, flags >>= 1)
+        {
+            if (flags & 1)
+            {
+                if (ip >= inSize) return 1;
+                out[op++] = in[ip++];
+            }
+            else
+            {
+                long rpos, rlen, ptr;
+
+                if (ip + 1 >= inSize) return 1;
+                rpos = in[ip] | ((in[ip + 1] & 0xF0) << 4);
+                rlen = (in[ip + 1] & 0x0F) + 3;
+                ip += 2;
+
+                for (ptr = op - rpos; rlen > 0 && op < outSize; rlen--, ptr++)
+                {
+                    out[op++] = (ptr < 0) ? 0x20 : out[ptr];
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+//=============================================================================
+
+static void Unpack565(int c, unsigned char *rgba)
+{
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+
+    rgba[0] = (unsigned char)((r << 3) | (r >> 2));
+    rgba[1] = (unsigned char)((g << 2) | (g >> 4));
+    rgba[2] = (unsigned char)((b << 3) | (b >> 2));
+    rgba[3] = 255;
+}
+
+//=============================================================================
+// Palette of one 4x4 colour block, returns the 16 2 bit indices. DXT3/5
+// always use four colours, DXT1 switches to three plus transparent when
+// c0 <= c1.
+
+static unsigned long GetBlockColors(const unsigned char *block, int dxt1, unsigned char color[4][4])
+{
+    int c0 = block[0] | (block[1] << 8);
+    int c1 = block[2] | (block[3] << 8);
+    int k;
+
+    Unpack565(c0, color[0]);
+    Unpack565(c1, color[1]);
+
+    if (c0 > c1 || !dxt1)
+    {
+        for (k = 0; k < 3; k++)
+        {
+            color[2][k] = (unsigned char)((2 * color[0][k] + color[1][k]) / 3);
+            color[3][k] = (unsigned char)((color[0][k] + 2 * color[1][k]) / 3);
+        }
+        color[2][3] = color[3][3] = 255;
+    }
+    else
+    {
+        for (k = 0; k < 3; k++)
+        {
+            color[2][k] = (unsigned char)((color[0][k] + color[1][k]) / 2);
+            color[3][k] = 0;
+        }
+        color[2][3] = 255;
+        color[3][3] = 0;
+    }
+    return block[4] | (block[5] << 8) | ((unsigned long)block[6] << 16) | ((unsigned long)block[7] << 24);
+}
+
+//=============================================================================
+
+static void GetBlockAlpha(const unsigned char *block, int type, unsigned char alpha[16])
+{
+    int i;
+
+    if (type == PAA_DXT2 || type == PAA_DXT3) //Explicit 4 bit alpha
+    {
+        for (i = 0; i < 16; i++)
+        {
+            int a = (block[i / 2] >> ((i & 1) * 4)) & 15;
+            alpha[i] = (unsigned char)(a * 17);
+        }
+    }
+    else //Interpolated alpha, 3 bit indices
+    {
+        unsigned char table[8];
+        int           a0 = block[0];
+        int           a1 = block[1];
+        int           bitpos = 0;
+
+        table[0] = (unsigned char)a0;
+        table[1] = (unsigned char)a1;
+        for (i = 0; i < 6; i++)
+        {
+            table[i + 2] = (a0 > a1) ? (unsigned char)(((6 - i) * a0 + (i + 1) * a1) / 7)
+                                     : (unsigned char)((i < 4) ? ((4 - i) * a0 + (i + 1) * a1) / 5 : (i == 4 ? 0 : 255));
+        }
+        for (i = 0; i < 16; i++, bitpos += 3)
+        {
+            int byte = 2 + bitpos / 8;
+            int value = block[byte] | ((byte + 1 < 8) ? block[byte + 1] << 8 : 0);
+            alpha[i] = table[(value >> (bitpos % 8)) & 7];
+        }
+    }
+}
+
+//=============================================================================
+// Whole block in four registers, one row each. SSE2 can't shift lanes by
+// different amounts, so every lane keeps its own 2 bit field of the row and
+// is compared against that field holding 0..3; the matching palette colour
+// is masked in. Alpha, if any, replaces the top byte of every pixel.
+
+#ifdef TEXTURE_SSE2
+static void DecodeBlockSSE2(unsigned char color[4][4], unsigned long bits, const unsigned char *alpha, __m128i row[4])
+{
+    const __m128i field = _mm_set_epi32(192, 48, 12, 3);
+    const __m128i one = _mm_set_epi32(64, 16, 4, 1);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i       palette[4];
+    __m128i       index[4];
+    int           packed;
+    int           i, r;
+
+    for (i = 0; i < 4; i++)
+    {
+        memcpy(&packed, color[i], 4); //Memory order, so the bytes come out as they went in
+        palette[i] = _mm_set1_epi32(packed);
+    }
+    index[0] = zero;
+    index[1] = one;
+    index[2] = _mm_add_epi32(one, one);
+    index[3] = field;
+
+    for (r = 0; r < 4; r++)
+    {
+        __m128i fields = _mm_and_si128(_mm_set1_epi32((int)((bits >> (8 * r)) & 0xFF)), field);
+        __m128i pixels = zero;
+
+        for (i = 0; i < 4; i++)
+        {
+            pixels = _mm_or_si128(pixels, _mm_and_si128(_mm_cmpeq_epi32(fields, index[i]), palette[i]));
+        }
+        if (alpha)
+        {
+            __m128i a;
+
+            memcpy(&packed, alpha + 4 * r, 4);
+            a = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+            pixels = _mm_or_si128(_mm_and_si128(pixels, _mm_set1_epi32(0x00FFFFFF)), _mm_slli_epi32(a, 24));
+        }
+        row[r] = pixels;
+    }
+}
+#endif
+
+//=============================================================================
+
+static int DecodeDXT(const unsigned char *in, long inSize, int type, int width, int height, unsigned char *rgba)
+{
+    unsigned char pixel[16][4];
+    unsigned char color[4][4];
+    unsigned char alpha[16];
+    unsigned long bits;
+    int           blockSize = (type == PAA_DXT1) ? 8 : 16;
+    int           bw = (width + 3) / 4;
+    int           bh = (height + 3) / 4;
+    int           bx, by, i;
+    #ifdef TEXTURE_SSE2
+    __m128i       row[4];
+    #endif
+
+    if ((long)bw * bh * blockSize > inSize)
+    {
+        return 1;
+    }
+
+    for (by = 0; by < bh; by++)
+    {
+        for (bx = 0; bx < bw; bx++)
+        {
+            const unsigned char *block = in + ((long)by * bw + bx) * blockSize;
+
+            if (type == PAA_DXT1)
+            {
+                bits = GetBlockColors(block, 1, color);
+            }
+            else
+            {
+                bits = GetBlockColors(block + 8, 0, color);
+                GetBlockAlpha(block, type, alpha);
+            }
+
+            #ifdef TEXTURE_SSE2
+            DecodeBlockSSE2(color, bits, (type == PAA_DXT1) ? NULL : alpha, row);
+            if (bx * 4 + 4 <= width && by * 4 + 4 <= height) //Inner block, rows go straight to the image
+            {
+                for (i = 0; i < 4; i++)
+                {
+                    _mm_storeu_si128((__m128i *)&rgba[((long)(by * 4 + i) * width + bx * 4) * 4], row[i]);
+                }
+                continue;
+            }
+            for (i = 0; i < 4; i++)
+            {
+                _mm_storeu_si128((__m128i *)pixel[i * 4], row[i]);
+            }
+            #else
+            for (i = 0; i < 16; i++, bits >>= 2)
+            {
+                memcpy(pixel[i], color[bits & 3], 4);
+                if (type != PAA_DXT1) pixel[i][3] = alpha[i];
+            }
+            #endif
+
+            for (i = 0; i < 16; i++) //Edge block of an image that is no multiple of 4
+            {
+                int x = bx * 4 + (i & 3);
+                int y = by * 4 + (i >> 2);
+                if (x < width && y < height)
+                {
+                    memcpy(&rgba[((long)y * width + x) * 4], pixel[i], 4);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+//=============================================================================
+
+static void DecodePixels(const unsigned char *in, int type, const unsigned char *palette, long count, unsigned char *rgba)
+{
+    long i;
+
+    for (i = 0; i < count; i++, rgba += 4)
+    {
+        int v;
+
+        switch (type)
+        {
+            case PAA_INDEXED: //Palette triplets are stored B, G, R
+                rgba[0] = palette[in[i] * 3 + 2];
+                rgba[1] = palette[in[i] * 3 + 1];
+                rgba[2] = palette[in[i] * 3 + 0];
+                rgba[3] = 255;
+                break;
+            case PAA_ARGB4444:
+                v = in[i * 2] | (in[i * 2 + 1] << 8);
+                rgba[0] = (unsigned char)(((v >> 8) & 15) * 17);
+                rgba[1] = (unsigned char)(((v >> 4) & 15) * 17);
+                rgba[2] = (unsigned char)((v & 15) * 17);
+                rgba[3] = (unsigned char)(((v >> 12) & 15) * 17);
+                break;
+            case PAA_ARGB1555:
+                v = in[i * 2] | (in[i * 2 + 1] << 8);
+                rgba[0] = (unsigned char)((((v >> 10) & 31) << 3) | (((v >> 10) & 31) >> 2));
+                rgba[1] = (unsigned char)((((v >> 5) & 31) << 3)  | (((v >> 5) & 31) >> 2));
+                rgba[2] = (unsigned char)(((v & 31) << 3)         | ((v & 31) >> 2));
+                rgba[3] = (v & 0x8000) ? 255 : 0;
+                break;
+            case PAA_AI88:
+                rgba[0] = rgba[1] = rgba[2] = in[i * 2];
+                rgba[3] = in[i * 2 + 1];
+                break;
+        }
+    }
+}
+
+//=============================================================================
+
+int DecodePAA(const unsigned char *data, long size, int *width, int *height, unsigned char **rgba)
+{
+    const unsigned char *palette = NULL;
+    unsigned char       *raw = NULL;
+    long                pos = 0;
+    unsigned long       tagg;
+    long                length;
+    long                count;
+    int                 type = PAA_INDEXED;
+    int                 nPalette;
+    int                 bpp;
+    int                 result = 1;
+
+    *rgba = NULL;
+    if (size < 2)
+    {
+        return 1;
+    }
+
+    switch (data[0] | (data[1] << 8))
+    {
+        case PAA_DXT1: case PAA_DXT2: case PAA_DXT3: case PAA_DXT4: case PAA_DXT5:
+        case PAA_ARGB4444: case PAA_ARGB1555: case PAA_AI88:
+            type = data[0] | (data[1] << 8);
+            pos = 2;
+            break;
+        default: //PAC, starts straight with the taggs or the palette
+            break;
+    }
+
+    while (pos + 12 <= size && (data[pos] | (data[pos + 1] << 8) | ((long)data[pos + 2] << 16) | ((long)data[pos + 3] << 24)) == TAGG_SIGNATURE)
+    {
+        tagg = data[pos + 8] | (data[pos + 9] << 8) | ((unsigned long)data[pos + 10] << 16) | ((unsigned long)data[pos + 11] << 24);
+        pos += 12;
+        if (tagg > (unsigned long)(size - pos)) //Also catches lengths that would go negative as a long
+        {
+            return 1;
+        }
+        pos += (long)tagg;
+    }
+
+    if (pos + 2 > size) return 1;
+    nPalette = data[pos] | (data[pos + 1] << 8);
+    pos += 2;
+    palette = data + pos;
+    pos += nPalette * 3;
+    if (type == PAA_INDEXED && nPalette < 256)
+    {
+        return 1; //Not a palette we can trust, most likely not a PAC at all
+    }
+
+    if (pos + 7 > size) return 1;
+    *width = data[pos] | (data[pos + 1] << 8);
+    *height = data[pos + 2] | (data[pos + 3] << 8);
+    length = data[pos + 4] | (data[pos + 5] << 8) | ((long)data[pos + 6] << 16);
+    pos += 7;
+
+    if ((*width & 0x8000) || (*width == 1234 && *height == 8765)) //LZO compressed variants, later engines only
+    {
+        fprintf(stderr, "Alert: LZO compressed textures are not supported!\n");
+        return 1;
+    }
+    if (*width <= 0 || *height <= 0 || *width > TEXTURE_MAX_SIZE || *height > TEXTURE_MAX_SIZE || pos + length > size)
+    {
+        return 1;
+    }
+
+    count = (long)*width * *height;
+    *rgba = (unsigned char *)malloc(count * 4);
+    if (!*rgba)
+    {
+        return 1;
+    }
+
+    if (type >= PAA_DXT1 && type <= PAA_DXT5)
+    {
+        result = DecodeDXT(data + pos, length, type, *width, *height, *rgba);
+    }
+    else
+    {
+        bpp = (type == PAA_INDEXED) ? 1 : 2;
+        raw = (unsigned char *)malloc(count * bpp);
+        if (raw && !ReadLZSS(data + pos, length, raw, count * bpp))
+        {
+            DecodePixels(raw, type, palette, count, *rgba);
+            result = 0;
+        }
+        free(raw);
+    }
+
+    if (result)
+    {
+        free(*rgba);
+        *rgba = NULL;
+    }
+    return result;
+}
+
+//=============================================================================
+
+static int WriteTGAFile(const char *path, int width, int height, const unsigned char *rgba)
+{
+    unsigned char header[18];
+    unsigned char *row;
+    FILE          *file;
+    int           x,y;
+
+    file = fopen(path, "wb");
+    row = (unsigned char *)malloc(width * 4);
+    if (!file || !row)
+    {
+        if (file) fclose(file);
+        free(row);
+        return 1;
+    }
+
+    memset(header, 0, sizeof(header));
+    header[2] = 2;                    //Uncompressed true colour
+    header[12] = (unsigned char)(width & 0xFF);
+    header[13] = (unsigned char)(width >> 8);
+    header[14] = (unsigned char)(height & 0xFF);
+    header[15] = (unsigned char)(height >> 8);
+    header[16] = 32;
+    header[17] = 0x28;                //8 alpha bits, top left origin
+    fwrite(header, 1, sizeof(header), file);
+
+    for (y = 0; y < height; y++)
+    {
+        for (x = 0; x < width; x++) //RGBA -> BGRA
+        {
+            const unsigned char *p = &rgba[((long)y * width + x) * 4];
+            row[x * 4 + 0] = p[2];
+            row[x * 4 + 1] = p[1];
+            row[x * 4 + 2] = p[0];
+            row[x * 4 + 3] = p[3];
+        }
+        fwrite(row, 4, width, file);
+    }
+
+    free(row);
+    if (ferror(file))
+    {
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+    return 0;
+}
+
+//=============================================================================
+
+void GetTextureImageName(const char *texture, char *image)
+{
+    int i;
+
+    for (i = 0; texture[i] && i < 31; i++) //"LandText\mo.pac" -> "LandText_mo.pac.tga", x.pac and x.paa stay apart
+    {
+        image[i] = (texture[i] == '\\' || texture[i] == '/' || texture[i] == ':' || texture[i] == ' ') ? '_' : texture[i];
+    }
+    image[i] = '\0';
+    strcat(image, ".tga");
+}
+
+//=============================================================================
+
+static void DecodeTexture(void *context, int index)
+{
+    struct TextureJob *job = &((struct TextureJob *)context)[index];
+    unsigned char     *data = NULL;
+    unsigned char     *rgba;
+    char              *source;
+    char              *target;
+    char              *temp;
+    long              size = 0;
+    int               width, height;
+    int               entry;
+    FILE              *file;
+
+    //Roots and output folders can be arbitrarily long, the names are not
+    source = (char *)malloc(strlen(job->root) + strlen(job->Name) + 2);
+    target = (char *)malloc(strlen(job->outdir) + sizeof(job->Image));
+    temp = (char *)malloc(strlen(job->outdir) + sizeof(job->Image) + 4);
+    if (!source || !target || !temp)
+    {
+        free(source);
+        free(target);
+        free(temp);
+        job->failed = 1;
+        return;
+    }
+
+    sprintf(source, "%s/%s", job->root, job->Name);
+    #ifndef _WIN32
+    {
+        char *p;
+        for (p = source; *p; p++) //Texture names use Windows separators
+        {
+            if (*p == '\\') *p = '/';
+        }
+    }
+    #endif
+    sprintf(target, "%s%s", job->outdir, job->Image);
+    sprintf(temp, "%s.tmp", target);
+
+    //A missing or broken source only costs that image, the model is still worth converting
+    file = fopen(source, "rb");
+    if (file)
+    {
+        fseek(file, 0, SEEK_END);
+        size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        data = (size >= 0) ? (unsigned char *)malloc(size > 0 ? size : 1) : NULL;
+        if (data && (long)fread(data, 1, size, file) != size)
+        {
+            free(data);
+            data = NULL;
+        }
+        fclose(file);
+    }
+
+    if (!data)
+    {
+        fprintf(stderr, "Alert: Error loading texture <%s>, skipped!\n", source);
+    }
+    else if (ClaimTexture(target, size, HashBytes(FNV64_OFFSET, data, size), &entry))
+    {
+        if (DecodePAA(data, size, &width, &height, &rgba))
+        {
+            fprintf(stderr, "Alert: Error decoding texture <%s>, skipped!\n", source);
+            ReleaseTexture(entry, 1);
+        }
+        else
+        {
+            job->failed = WriteTGAFile(temp, width, height, rgba); //Waiting requests only see whole images
+            if (job->failed)
+            {
+                remove(temp);
+            }
+            else
+            {
+                job->failed = CommitTempFile(temp, target);
+            }
+            free(rgba);
+            ReleaseTexture(entry, job->failed);
+        }
+    }
+    free(data);
+    free(source);
+    free(target);
+    free(temp);
+}
+
+//=============================================================================
+
+static int CompareNames(const void *a, const void *b)
+{
+    return strncmp((const char *)a, (const char *)b, 32);
+}
+
+//=============================================================================
+
+static int CompareImages(const void *a, const void *b)
+{
+    return strcmp(((const struct TextureJob *)a)->Image, ((const struct TextureJob *)b)->Image);
+}
+
+//=============================================================================
+
+int DecodeTextures(char (*names)[32], int count, const char *root, const char *outdir)
+{
+    struct TextureJob *job;
+    int               nJobs = 0;
+    int               nUnique = 0;
+    int               failed = 0;
+    int               i;
+
+    qsort(names, count, 32, CompareNames);
+
+    job = (struct TextureJob *)calloc(count ? count : 1, sizeof(struct TextureJob));
+    if (!job)
+    {
+        return 1;
+    }
+    for (i = 0; i < count; i++) //Unique and non empty only
+    {
+        if (names[i][0] == '\0' || (i > 0 && strncmp(names[i], names[i - 1], 32) == 0))
+        {
+            continue;
+        }
+        names[i][31] = '\0';
+        job[nJobs].Name = names[i];
+        GetTextureImageName(names[i], job[nJobs].Image);
+        job[nJobs].root = root;
+        job[nJobs].outdir = outdir;
+        nJobs++;
+    }
+
+    //"a\b.pac" and "a_b.pac" still share an image, only one of them may write it
+    qsort(job, nJobs, sizeof(struct TextureJob), CompareImages);
+    for (i = 0; i < nJobs; i++)
+    {
+        if (nUnique > 0 && strcmp(job[i].Image, job[nUnique - 1].Image) == 0)
+        {
+            fprintf(stderr, "Alert: <%s> and <%s> both decode to <%s>, <%s> is used for both!\n",
+                    job[nUnique - 1].Name, job[i].Name, job[i].Image, job[nUnique - 1].Name);
+            continue;
+        }
+        job[nUnique++] = job[i];
+    }
+    nJobs = nUnique;
+
+    ParallelFor(nJobs, DecodeTexture, job);
+
+    for (i = 0; i < nJobs; i++)
+    {
+        failed |= job[i].failed;
+    }
+
+    #ifdef _DEBUG
+    printf("Debug: Textures: %d unique of %d references\n", nJobs, count);
+    #endif
+
+    free(job);
+    return failed;
+}
+
+//=============================================================================
+// One material per distinct texture, named like the texture. Sorts "names"
+// in place, empty ones are skipped.
+
+int WriteMaterials(FILE *file, char (*names)[32], int count)
+{
+    char image[40];
+    int  i;
+
+    for (i = 0; i < count; i++)
+    {
+        names[i][31] = '\0';
+    }
+    qsort(names, count, 32, CompareNames);
+
+    for (i = 0; i < count; i++)
+    {
+        if (names[i][0] == '\0' || (i > 0 && strcmp(names[i], names[i - 1]) == 0))
+        {
+            continue;
+        }
+        GetTextureImageName(names[i], image);
+        fprintf(file, "newmtl %s\n", names[i]);
+        fprintf(file, "Kd 1.000000 1.000000 1.000000\n");
+        fprintf(file, "map_Kd %s\n\n", image);
+    }
+    return ferror(file) != 0;
+}
+
+//=============================================================================
+
+int WriteMTLFile(FILE *file, struct P3D *p3d)
+{
+    char (*names)[32];
+    int  i;
+    int  result;
+
+    names = (char (*)[32])malloc((p3d->data.nFaces ? p3d->data.nFaces : 1) * 32);
+    if (!names)
+    {
+        return 1;
+    }
+    for (i = 0; i < p3d->data.nFaces; i++)
+    {
+        memcpy(names[i], p3d->lodface[i].TextureName, 32);
+    }
+    result = WriteMaterials(file, names, p3d->data.nFaces);
+
+    free(names);
+    return result;
+}
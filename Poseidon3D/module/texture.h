@@ -0,0 +1,53 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+#include "poseidon.h"
+
+//=============================================================================
+// DATA SIGNS
+//=============================================================================
+
+#define PAA_DXT1     0xFF01
+#define PAA_DXT2     0xFF02
+#define PAA_DXT3     0xFF03
+#define PAA_DXT4     0xFF04
+#define PAA_DXT5     0xFF05
+#define PAA_ARGB4444 0x4444
+#define PAA_ARGB1555 0x1555
+#define PAA_AI88     0x8080
+#define PAA_INDEXED  0x0000 //No type tag, 8 bit palette (PAC)
+
+#define TAGG_SIGNATURE 0x54414747 //"GGAT"
+
+#define TEXTURE_MAX_SIZE 4096
+
+#define TEXTURE_PENDING 0 //Registry states, see ClaimTexture
+#define TEXTURE_DONE    1
+#define TEXTURE_FAILED  2
+
+//=============================================================================
+// PROTOTYPING
+//=============================================================================
+
+void InitTextureCache(void);
+
+//=============================================================================
+
+int DecodePAA(const unsigned char *data, long size, int *width, int *height, unsigned char **rgba);
+
+//=============================================================================
+
+void GetTextureImageName(const char *texture, char *image);
+
+//=============================================================================
+
+int DecodeTextures(char (*names)[32], int count, const char *root, const char *outdir);
+
+//=============================================================================
+
+int WriteMaterials(FILE *file, char (*names)[32], int count);
+
+//=============================================================================
+
+int WriteMTLFile(FILE *file, struct P3D *p3d);
+
+#endif // TEXTURE_H
@@ -0,0 +1,698 @@
+//=============================================================================
+//
+//  Module:         Thread - minimal worker threads for the converter stages
+//
+//  Author:         GameSpy
+//
+//  Date:           Started 19.10.2026
+//
+//=============================================================================
+// One pool of GetThreadCount() workers serves everything: the ParallelFor
+// stages and the daemon queue. A ParallelFor caller works on its own job and
+// queues helpers at the front of the pool, helpers nobody picked up by the
+// time the caller is done are taken back. Nested loops and loops inside
+// daemon requests therefore never put more threads on the machine than it
+// has cores, and never wait on a worker that is busy elsewhere.
+//=============================================================================
+
+#include <stdlib.h>
+#include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#include "thread.h"
+
+#define MAX_THREADS 64
+
+struct ParallelJob
+{
+    void (*job)(void *context, int index);
+    void          *context;
+    int           count;
+    volatile long next;    //Shared index counter, every worker grabs the next one
+    int           active;  //Helpers running right now, guarded by the pool
+    int           waiting; //The caller sleeps until "active" drops to 0
+    #ifdef _WIN32
+    HANDLE        done;
+    #endif
+};
+
+//=============================================================================
+
+struct PoolTask
+{
+    struct ParallelJob *pj;    //Either a ParallelFor helper...
+    struct WorkQueue   *queue; //...or a queued item
+    void               *item;
+    struct PoolTask    *next;
+};
+
+//=============================================================================
+
+struct WorkQueue
+{
+    void (*job)(void *item);
+    int  pending;  //Queued or running, guarded by the pool
+    int  stopping;
+    #ifdef _WIN32
+    HANDLE done;
+    #endif
+};
+
+//=============================================================================
+
+struct ThreadPool
+{
+    struct PoolTask  *head;
+    struct PoolTask  *tail;
+    int              nThreads;
+    #ifdef _WIN32
+    CRITICAL_SECTION section;
+    HANDLE           available; //Semaphore, at least one count per queued task
+    volatile LONG    state;     //0 = not started, 1 = starting, 2 = running
+    #else
+    pthread_mutex_t  mutex;
+    pthread_cond_t   available;
+    pthread_cond_t   finished;  //A helper or a queued item is done
+    #endif
+};
+
+static struct ThreadPool Pool;
+#ifndef _WIN32
+static pthread_once_t    PoolOnce = PTHREAD_ONCE_INIT;
+#endif
+
+//=============================================================================
+
+static long FetchNextIndex(struct ParallelJob *pj)
+{
+    #ifdef _WIN32
+    return InterlockedIncrement(&pj->next) - 1;
+    #else
+    return __sync_fetch_and_add(&pj->next, 1);
+    #endif
+}
+
+//=============================================================================
+
+static void RunParallelJob(struct ParallelJob *pj)
+{
+    long index;
+
+    while ((index = FetchNextIndex(pj)) < pj->count)
+    {
+        pj->job(pj->context, (int)index);
+    }
+}
+
+//=============================================================================
+
+static void EnterPool(void)
+{
+    #ifdef _WIN32
+    EnterCriticalSection(&Pool.section);
+    #else
+    pthread_mutex_lock(&Pool.mutex);
+    #endif
+}
+
+//=============================================================================
+
+static void LeavePool(void)
+{
+    #ifdef _WIN32
+    LeaveCriticalSection(&Pool.section);
+    #else
+    pthread_mutex_unlock(&Pool.mutex);
+    #endif
+}
+
+//=============================================================================
+
+int GetThreadCount(void)
+{
+    int count;
+
+    #ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    count = (int)si.dwNumberOfProcessors;
+    #else
+    count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
+
+    if (count < 1)           count = 1;
+    if (count > MAX_THREADS) count = MAX_THREADS;
+    return count;
+}
+
+//=============================================================================
+
+#ifdef _WIN32
+static DWORD WINAPI PoolWorker(LPVOID param)
+#else
+static void *PoolWorker(void *param)
+#endif
+{
+    struct PoolTask *task;
+
+    (void)param; //Every worker serves the one pool
+
+    while (1)
+    {
+        #ifdef _WIN32
+        WaitForSingleObject(Pool.available, INFINITE);
+        EnterCriticalSection(&Pool.section);
+        #else
+        pthread_mutex_lock(&Pool.mutex);
+        while (!Pool.head)
+        {
+            pthread_cond_wait(&Pool.available, &Pool.mutex);
+        }
+        #endif
+
+        task = Pool.head;
+        if (task)
+        {
+            Pool.head = task->next;
+            if (!Pool.head) Pool.tail = NULL;
+            if (task->pj) task->pj->active++; //Under the same lock as the caller taking helpers back
+        }
+        LeavePool();
+
+        if (!task) //Count left behind by a helper that was taken back
+        {
+            continue;
+        }
+
+        if (task->pj)
+        {
+            struct ParallelJob *pj = task->pj;
+
+            RunParallelJob(pj);
+            EnterPool();
+            if (--pj->active == 0 && pj->waiting)
+            {
+                #ifdef _WIN32
+                SetEvent(pj->done);
+                #else
+                pthread_cond_broadcast(&Pool.finished);
+                #endif
+            }
+            LeavePool();
+        }
+        else
+        {
+            struct WorkQueue *queue = task->queue;
+
+            queue->job(task->item);
+            free(task);
+            EnterPool();
+            if (--queue->pending == 0 && queue->stopping)
+            {
+                #ifdef _WIN32
+                SetEvent(queue->done);
+                #else
+                pthread_cond_broadcast(&Pool.finished);
+                #endif
+            }
+            LeavePool();
+        }
+    }
+    return 0;
+}
+
+//=============================================================================
+// The workers live as long as the process, they are started on first use.
+
+static void StartPool(void)
+{
+    int count = GetThreadCount();
+    int i;
+
+    #ifdef _WIN32
+    InitializeCriticalSection(&Pool.section);
+    Pool.available = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+    #else
+    pthread_mutex_init(&Pool.mutex, NULL);
+    pthread_cond_init(&Pool.available, NULL);
+    pthread_cond_init(&Pool.finished, NULL);
+    #endif
+
+    for (i = 0; i < count; i++)
+    {
+        #ifdef _WIN32
+        HANDLE thread = Pool.available ? CreateThread(NULL, 0, PoolWorker, NULL, 0, NULL) : NULL;
+        if (!thread)
+        {
+            break;
+        }
+        CloseHandle(thread);
+        #else
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, PoolWorker, NULL) != 0)
+        {
+            break;
+        }
+        pthread_detach(thread);
+        #endif
+    }
+    Pool.nThreads = i;
+}
+
+//=============================================================================
+
+static int GetPoolSize(void)
+{
+    #ifdef _WIN32
+    if (InterlockedCompareExchange(&Pool.state, 1, 0) == 0)
+    {
+        StartPool();
+        InterlockedExchange(&Pool.state, 2);
+    }
+    while (Pool.state != 2)
+    {
+        Sleep(0);
+    }
+    #else
+    pthread_once(&PoolOnce, StartPool);
+    #endif
+    return Pool.nThreads;
+}
+
+//=============================================================================
+// Queues a chain of tasks, helpers go first so running loops finish early.
+
+static void PushTasks(struct PoolTask *first, struct PoolTask *last, int count, int front)
+{
+    EnterPool();
+    if (front)
+    {
+        last->next = Pool.head;
+        Pool.head = first;
+        if (!Pool.tail) Pool.tail = last;
+    }
+    else
+    {
+        last->next = NULL;
+        if (Pool.tail) Pool.tail->next = first;
+        else           Pool.head = first;
+        Pool.tail = last;
+    }
+    #ifdef _WIN32
+    LeaveCriticalSection(&Pool.section);
+    ReleaseSemaphore(Pool.available, count, NULL);
+    #else
+    if (count == 1) pthread_cond_signal(&Pool.available);
+    else            pthread_cond_broadcast(&Pool.available);
+    pthread_mutex_unlock(&Pool.mutex);
+    #endif
+}
+
+//=============================================================================
+
+void ParallelFor(int count, void (*job)(void *context, int index), void *context)
+{
+    struct ParallelJob pj;
+    struct PoolTask    helper[MAX_THREADS];
+    struct PoolTask    **link;
+    int                nHelpers;
+    int                i;
+
+    pj.job = job;
+    pj.context = context;
+    pj.count = count;
+    pj.next = 0;
+    pj.active = 0;
+    pj.waiting = 0;
+
+    nHelpers = GetThreadCount() - 1; //The calling thread is worker number 0
+    if (nHelpers > count - 1) nHelpers = count - 1;
+    if (nHelpers > 0 && nHelpers > GetPoolSize() - 1) nHelpers = GetPoolSize() - 1;
+
+    if (nHelpers <= 0) //No point in waking anyone, run it right here
+    {
+        RunParallelJob(&pj);
+        return;
+    }
+
+    for (i = 0; i < nHelpers; i++)
+    {
+        helper[i].pj = &pj;
+        helper[i].queue = NULL;
+        helper[i].item = NULL;
+        helper[i].next = (i + 1 < nHelpers) ? &helper[i + 1] : NULL;
+    }
+    #ifdef _WIN32
+    pj.done = NULL;
+    #endif
+    PushTasks(&helper[0], &helper[nHelpers - 1], nHelpers, 1);
+
+    RunParallelJob(&pj);
+
+    EnterPool();
+    Pool.tail = NULL;
+    for (link = &Pool.head; *link; ) //Take back the helpers nobody got to
+    {
+        if ((*link)->pj == &pj)
+        {
+            *link = (*link)->next;
+            continue;
+        }
+        Pool.tail = *link;
+        link = &(*link)->next;
+    }
+    #ifdef _WIN32
+    if (pj.active > 0)
+    {
+        pj.done = CreateEvent(NULL, TRUE, FALSE, NULL);
+        pj.waiting = (pj.done != NULL);
+    }
+    while (!pj.done && pj.active > 0) //No event to wait on, poll
+    {
+        LeaveCriticalSection(&Pool.section);
+        Sleep(1);
+        EnterCriticalSection(&Pool.section);
+    }
+    LeaveCriticalSection(&Pool.section);
+    if (pj.done)
+    {
+        WaitForSingleObject(pj.done, INFINITE);
+        CloseHandle(pj.done);
+    }
+    #else
+    pj.waiting = 1;
+    while (pj.active > 0)
+    {
+        pthread_cond_wait(&Pool.finished, &Pool.mutex);
+    }
+    pthread_mutex_unlock(&Pool.mutex);
+    #endif
+}
+
+//=============================================================================
+// Detached threads, locks, signals and the daemon work queue
+//=============================================================================
+
+struct ThreadStart
+{
+    void (*entry)(void *context);
+    void *context;
+};
+
+//=============================================================================
+
+#ifdef _WIN32
+static DWORD WINAPI ThreadTrampoline(LPVOID param)
+#else
+static void *ThreadTrampoline(void *param)
+#endif
+{
+    struct ThreadStart start = *(struct ThreadStart *)param;
+
+    free(param);
+    start.entry(start.context);
+    return 0;
+}
+
+//=============================================================================
+
+int StartThread(void (*entry)(void *context), void *context)
+{
+    struct ThreadStart *start = (struct ThreadStart *)malloc(sizeof(struct ThreadStart));
+    #ifdef _WIN32
+    HANDLE thread;
+    #else
+    pthread_t thread;
+    #endif
+
+    if (!start)
+    {
+        return 1;
+    }
+    start->entry = entry;
+    start->context = context;
+
+    #ifdef _WIN32
+    thread = CreateThread(NULL, 0, ThreadTrampoline, start, 0, NULL);
+    if (!thread)
+    {
+        free(start);
+        return 1;
+    }
+    CloseHandle(thread);
+    #else
+    if (pthread_create(&thread, NULL, ThreadTrampoline, start) != 0)
+    {
+        free(start);
+        return 1;
+    }
+    pthread_detach(thread);
+    #endif
+    return 0;
+}
+
+//=============================================================================
+
+struct Lock
+{
+    #ifdef _WIN32
+    CRITICAL_SECTION section;
+    #else
+    pthread_mutex_t  mutex;
+    #endif
+};
+
+//=============================================================================
+
+struct Lock *CreateLock(void)
+{
+    struct Lock *lock = (struct Lock *)malloc(sizeof(struct Lock));
+
+    if (lock)
+    {
+        #ifdef _WIN32
+        InitializeCriticalSection(&lock->section);
+        #else
+        pthread_mutex_init(&lock->mutex, NULL);
+        #endif
+    }
+    return lock;
+}
+
+//=============================================================================
+
+void EnterLock(struct Lock *lock)
+{
+    #ifdef _WIN32
+    EnterCriticalSection(&lock->section);
+    #else
+    pthread_mutex_lock(&lock->mutex);
+    #endif
+}
+
+//=============================================================================
+
+void LeaveLock(struct Lock *lock)
+{
+    #ifdef _WIN32
+    LeaveCriticalSection(&lock->section);
+    #else
+    pthread_mutex_unlock(&lock->mutex);
+    #endif
+}
+
+//=============================================================================
+
+void DestroyLock(struct Lock *lock)
+{
+    if (!lock)
+    {
+        return;
+    }
+    #ifdef _WIN32
+    DeleteCriticalSection(&lock->section);
+    #else
+    pthread_mutex_destroy(&lock->mutex);
+    #endif
+    free(lock);
+}
+
+//=============================================================================
+// Manual reset signal, for threads that wait on something another thread
+// finishes (a texture being decoded). Created raised.
+
+struct Signal
+{
+    #ifdef _WIN32
+    HANDLE          event;
+    #else
+    pthread_mutex_t mutex;
+    pthread_cond_t  changed;
+    int             raised;
+    #endif
+};
+
+//=============================================================================
+
+struct Signal *CreateSignal(void)
+{
+    struct Signal *signal = (struct Signal *)malloc(sizeof(struct Signal));
+
+    if (!signal)
+    {
+        return NULL;
+    }
+    #ifdef _WIN32
+    signal->event = CreateEvent(NULL, TRUE, TRUE, NULL);
+    if (!signal->event)
+    {
+        free(signal);
+        return NULL;
+    }
+    #else
+    pthread_mutex_init(&signal->mutex, NULL);
+    pthread_cond_init(&signal->changed, NULL);
+    signal->raised = 1;
+    #endif
+    return signal;
+}
+
+//=============================================================================
+
+void RaiseSignal(struct Signal *signal)
+{
+    #ifdef _WIN32
+    SetEvent(signal->event);
+    #else
+    pthread_mutex_lock(&signal->mutex);
+    signal->raised = 1;
+    pthread_cond_broadcast(&signal->changed);
+    pthread_mutex_unlock(&signal->mutex);
+    #endif
+}
+
+//=============================================================================
+
+void ClearSignal(struct Signal *signal)
+{
+    #ifdef _WIN32
+    ResetEvent(signal->event);
+    #else
+    pthread_mutex_lock(&signal->mutex);
+    signal->raised = 0;
+    pthread_mutex_unlock(&signal->mutex);
+    #endif
+}
+
+//=============================================================================
+
+void WaitSignal(struct Signal *signal)
+{
+    #ifdef _WIN32
+    WaitForSingleObject(signal->event, INFINITE);
+    #else
+    pthread_mutex_lock(&signal->mutex);
+    while (!signal->raised)
+    {
+        pthread_cond_wait(&signal->changed, &signal->mutex);
+    }
+    pthread_mutex_unlock(&signal->mutex);
+    #endif
+}
+
+//=============================================================================
+
+void DestroySignal(struct Signal *signal)
+{
+    if (!signal)
+    {
+        return;
+    }
+    #ifdef _WIN32
+    CloseHandle(signal->event);
+    #else
+    pthread_cond_destroy(&signal->changed);
+    pthread_mutex_destroy(&signal->mutex);
+    #endif
+    free(signal);
+}
+
+//=============================================================================
+// Items run on the shared pool, in the order they were pushed.
+
+struct WorkQueue *CreateWorkQueue(void (*job)(void *item))
+{
+    struct WorkQueue *queue;
+
+    if (GetPoolSize() == 0)
+    {
+        return NULL;
+    }
+    queue = (struct WorkQueue *)calloc(1, sizeof(struct WorkQueue));
+    if (!queue)
+    {
+        return NULL;
+    }
+    queue->job = job;
+
+    #ifdef _WIN32
+    queue->done = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!queue->done)
+    {
+        free(queue);
+        return NULL;
+    }
+    #endif
+    return queue;
+}
+
+//=============================================================================
+
+void PushWork(struct WorkQueue *queue, void *item)
+{
+    struct PoolTask *task = (struct PoolTask *)malloc(sizeof(struct PoolTask));
+
+    if (!task) //Better late than never
+    {
+        queue->job(item);
+        return;
+    }
+    task->pj = NULL;
+    task->queue = queue;
+    task->item = item;
+
+    EnterPool();
+    queue->pending++;
+    LeavePool();
+    PushTasks(task, task, 1, 0);
+}
+
+//=============================================================================
+// Finishes everything already queued, the pool itself keeps running.
+
+void DestroyWorkQueue(struct WorkQueue *queue)
+{
+    EnterPool();
+    queue->stopping = 1;
+    #ifdef _WIN32
+    if (queue->pending == 0)
+    {
+        SetEvent(queue->done);
+    }
+    LeaveCriticalSection(&Pool.section);
+    WaitForSingleObject(queue->done, INFINITE);
+    CloseHandle(queue->done);
+    #else
+    while (queue->pending > 0)
+    {
+        pthread_cond_wait(&Pool.finished, &Pool.mutex);
+    }
+    pthread_mutex_unlock(&Pool.mutex);
+    #endif
+
+    free(queue);
+}
@@ -0,0 +1,39 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+//=============================================================================
+// PROTOTYPING
+//=============================================================================
+
+int GetThreadCount(void);
+
+//=============================================================================
+
+void ParallelFor(int count, void (*job)(void *context, int index), void *context);
+
+//=============================================================================
+
+int StartThread(void (*entry)(void *context), void *context);
+
+//=============================================================================
+
+struct Lock *CreateLock(void);
+void EnterLock(struct Lock *lock);
+void LeaveLock(struct Lock *lock);
+void DestroyLock(struct Lock *lock);
+
+//=============================================================================
+
+struct Signal *CreateSignal(void);
+void RaiseSignal(struct Signal *signal);
+void ClearSignal(struct Signal *signal);
+void WaitSignal(struct Signal *signal);
+void DestroySignal(struct Signal *signal);
+
+//=============================================================================
+
+struct WorkQueue *CreateWorkQueue(void (*job)(void *item));
+void PushWork(struct WorkQueue *queue, void *item);
+void DestroyWorkQueue(struct WorkQueue *queue);
+
+#endif // THREAD_H
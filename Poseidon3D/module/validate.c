@@ -0,0 +1,262 @@
+//=============================================================================
+//
+//  Module:         Validate - sanity checks for untrusted P3D input
+//
+//  Author:         GameSpy
+//
+//  Date:           Started 19.10.2026
+//
+//=============================================================================
+// Counts from the file are checked against the bytes that are really left
+// before anything gets allocated. Face indices are checked with one min/max
+// reduction over the whole face table, which is all a healthy model ever
+// pays; only if the totals are out of range the faces are walked again to
+// find the bad ones.
+//=============================================================================
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "validate.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VALIDATE_SSE2
+#include <emmintrin.h>
+#endif
+
+//=============================================================================
+// Bytes between the read position and the end of the stream, -1 if the
+// stream can't seek.
+
+static long GetRemainingBytes(FILE *file)
+{
+    long pos = ftell(file);
+    long end;
+
+    if (pos < 0 || fseek(file, 0, SEEK_END) != 0)
+    {
+        return -1;
+    }
+    end = ftell(file);
+    fseek(file, pos, SEEK_SET);
+    return (end < pos) ? -1 : end - pos;
+}
+
+//=============================================================================
+// Pipes can't tell what is left, there a section may not need more than any
+// model could sensibly be; the readers check their freads on top of that.
+
+int CheckSectionSize(FILE *file, double bytes, const char *section)
+{
+    long remaining = GetRemainingBytes(file);
+
+    if (remaining < 0)
+    {
+        if (bytes < 0.0 || bytes > (double)VALIDATE_MAX_STREAM)
+        {
+            fprintf(stderr, "Alert: %s needs %.0f bytes, a stream may only have %d!\n", section, bytes, VALIDATE_MAX_STREAM);
+            return 1;
+        }
+        return 0;
+    }
+    if (bytes < 0.0 || bytes > (double)remaining)
+    {
+        fprintf(stderr, "Alert: %s needs %.0f bytes, the file has %ld left!\n", section, bytes, remaining);
+        return 1;
+    }
+    return 0;
+}
+
+//=============================================================================
+
+int ValidateP3DData(FILE *file, struct P3D *p3d, struct RVHeader *rvh)
+{
+    double bytes;
+
+    if (p3d->data.nPoints < 0 || p3d->data.nFaceNormals < 0 || p3d->data.nFaces < 0)
+    {
+        fprintf(stderr, "Alert: Negative counts in P3DData (%d points, %d normals, %d faces)!\n",
+                p3d->data.nPoints, p3d->data.nFaceNormals, p3d->data.nFaces);
+        return 1;
+    }
+
+    if (rvh->Signature == SP3X_SIGNATURE) //Mirrors the readers, double can't overflow here
+    {
+        bytes = 4.0 + (double)p3d->data.nPoints * SP3X_POINT_SIZE + (double)p3d->data.nFaceNormals * sizeof(struct P3DTriplet) +
+                (double)p3d->data.nFaces * SP3X_FACE_SIZE;
+    }
+    else
+    {
+        bytes = (double)p3d->data.nPoints * SP3D_POINT_SIZE + (double)p3d->data.nFaceNormals * sizeof(struct P3DTriplet) +
+                (double)p3d->data.nFaces * SP3D_FACE_SIZE;
+    }
+    return CheckSectionSize(file, bytes, "P3DData");
+}
+
+//=============================================================================
+
+#ifdef VALIDATE_SSE2
+static __m128i Min32(__m128i a, __m128i b) //SSE2 has no signed 32 bit min/max
+{
+    __m128i greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a));
+}
+
+static __m128i Max32(__m128i a, __m128i b)
+{
+    __m128i greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+}
+#endif
+
+//=============================================================================
+// Smallest and largest PointsIndex/NormalsIndex over all used corners, plus
+// whether any FaceType is neither 3 nor 4.
+
+static int ReduceIndices(struct P3D *p3d, int minIndex[2], int maxIndex[2])
+{
+    int badType = 0;
+    int i;
+
+    #ifdef VALIDATE_SSE2
+    __m128i vmin = _mm_set1_epi32(0x7FFFFFFF);
+    __m128i vmax = _mm_set1_epi32(-0x7FFFFFFF - 1);
+    int     lanes[4];
+
+    for (i = 0; i < p3d->data.nFaces; i++)
+    {
+        struct P3DLodFace *face = &p3d->lodface[i];
+        __m128i           t0 = _mm_loadu_si128((const __m128i *)&face->p3dvertextable[0]); //Points, Normals, U, V
+        __m128i           t1 = _mm_loadu_si128((const __m128i *)&face->p3dvertextable[1]);
+        __m128i           t2 = _mm_loadu_si128((const __m128i *)&face->p3dvertextable[2]);
+        __m128i           t3 = (face->FaceType == 3) ? t0 : _mm_loadu_si128((const __m128i *)&face->p3dvertextable[3]);
+        __m128i           a = _mm_unpacklo_epi64(t0, t1); //P0 N0 P1 N1
+        __m128i           b = _mm_unpacklo_epi64(t2, t3); //P2 N2 P3 N3
+
+        badType |= (face->FaceType != 3 && face->FaceType != 4);
+        vmin = Min32(vmin, Min32(a, b));
+        vmax = Max32(vmax, Max32(a, b));
+    }
+
+    _mm_storeu_si128((__m128i *)lanes, vmin);
+    minIndex[0] = (lanes[0] < lanes[2]) ? lanes[0] : lanes[2];
+    minIndex[1] = (lanes[1] < lanes[3]) ? lanes[1] : lanes[3];
+    _mm_storeu_si128((__m128i *)lanes, vmax);
+    maxIndex[0] = (lanes[0] > lanes[2]) ? lanes[0] : lanes[2];
+    maxIndex[1] = (lanes[1] > lanes[3]) ? lanes[1] : lanes[3];
+    #else
+    int k;
+
+    minIndex[0] = minIndex[1] = 0x7FFFFFFF;
+    maxIndex[0] = maxIndex[1] = -0x7FFFFFFF - 1;
+    for (i = 0; i < p3d->data.nFaces; i++)
+    {
+        struct P3DLodFace *face = &p3d->lodface[i];
+
+        badType |= (face->FaceType != 3 && face->FaceType != 4);
+        for (k = 0; k < ((face->FaceType == 3) ? 3 : 4); k++)
+        {
+            int point = face->p3dvertextable[k].PointsIndex;
+            int normal = face->p3dvertextable[k].NormalsIndex;
+
+            if (point < minIndex[0])  minIndex[0] = point;
+            if (point > maxIndex[0])  maxIndex[0] = point;
+            if (normal < minIndex[1]) minIndex[1] = normal;
+            if (normal > maxIndex[1]) maxIndex[1] = normal;
+        }
+    }
+    #endif
+    return badType;
+}
+
+//=============================================================================
+
+static int IsFaceBroken(struct P3D *p3d, struct P3DLodFace *face)
+{
+    int k;
+
+    if (face->FaceType != 3 && face->FaceType != 4)
+    {
+        return 1;
+    }
+    for (k = 0; k < face->FaceType; k++)
+    {
+        struct P3DVertexTable *table = &face->p3dvertextable[k];
+
+        if ((unsigned int)table->PointsIndex >= (unsigned int)p3d->data.nPoints ||
+            (unsigned int)table->NormalsIndex >= (unsigned int)p3d->data.nFaceNormals)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//=============================================================================
+// Returns 0 if every face is usable, with repair set bad faces are dropped.
+
+int ValidateP3DFaces(struct P3D *p3d, int repair)
+{
+    int minIndex[2], maxIndex[2];
+    int nBroken = 0;
+    int nFaces = 0;
+    int hasBools;
+    int i;
+
+    if (p3d->data.nFaces == 0)
+    {
+        return 0;
+    }
+
+    if (!ReduceIndices(p3d, minIndex, maxIndex) &&
+        minIndex[0] >= 0 && maxIndex[0] < p3d->data.nPoints &&
+        minIndex[1] >= 0 && maxIndex[1] < p3d->data.nFaceNormals)
+    {
+        return 0;
+    }
+
+    hasBools = p3d->supply.TinyBools && p3d->supply.nPoints == p3d->data.nPoints &&
+               p3d->supply.nFaces == p3d->data.nFaces && p3d->supply.nNormals == p3d->data.nFaceNormals;
+
+    for (i = 0; i < p3d->data.nFaces; i++)
+    {
+        if (!IsFaceBroken(p3d, &p3d->lodface[i]))
+        {
+            if (hasBools) //Face bools move along with their face
+            {
+                p3d->supply.TinyBools[p3d->data.nPoints + nFaces] = p3d->supply.TinyBools[p3d->data.nPoints + i];
+            }
+            p3d->lodface[nFaces++] = p3d->lodface[i];
+            continue;
+        }
+        if (nBroken++ < VALIDATE_MAX_REPORT)
+        {
+            struct P3DLodFace *face = &p3d->lodface[i];
+            fprintf(stderr, "Alert: Face %d is broken (FaceType=%d, Points=%d,%d,%d,%d, Normals=%d,%d,%d,%d)!\n", i, face->FaceType,
+                    face->p3dvertextable[0].PointsIndex, face->p3dvertextable[1].PointsIndex,
+                    face->p3dvertextable[2].PointsIndex, face->p3dvertextable[3].PointsIndex,
+                    face->p3dvertextable[0].NormalsIndex, face->p3dvertextable[1].NormalsIndex,
+                    face->p3dvertextable[2].NormalsIndex, face->p3dvertextable[3].NormalsIndex);
+        }
+    }
+    if (nBroken > VALIDATE_MAX_REPORT)
+    {
+        fprintf(stderr, "Alert: ... and %d more broken faces!\n", nBroken - VALIDATE_MAX_REPORT);
+    }
+
+    if (!repair)
+    {
+        fprintf(stderr, "Alert: %d of %d faces are broken, use -repair to drop them!\n", nBroken, p3d->data.nFaces);
+        return 1;
+    }
+
+    fprintf(stderr, "Alert: Dropped %d of %d faces!\n", nBroken, p3d->data.nFaces);
+    if (hasBools) //Close the gap in front of the normal bools
+    {
+        memmove(p3d->supply.TinyBools + p3d->data.nPoints + nFaces,
+                p3d->supply.TinyBools + p3d->data.nPoints + p3d->data.nFaces, p3d->data.nFaceNormals);
+        p3d->supply.nFaces = nFaces;
+    }
+    p3d->data.nFaces = nFaces;
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef VALIDATE_H
+#define VALIDATE_H
+#include "poseidon.h"
+
+//=============================================================================
+// DATA SIGNS
+//=============================================================================
+
+#define VALIDATE_MAX_STREAM 0x04000000 //64MB, what a stream of unknown size may still hold
+#define VALIDATE_MAX_REPORT 10         //Bad faces listed one by one, the rest is counted
+
+#define SP3X_POINT_SIZE 16  //struct P3DPoint on disk
+#define SP3D_POINT_SIZE 12  //Position only
+#define SP3X_FACE_SIZE  104 //struct P3DLodFace on disk
+#define SP3D_FACE_SIZE  100 //No FaceFlags
+
+//=============================================================================
+// PROTOTYPING
+//=============================================================================
+
+int CheckSectionSize(FILE *file, double bytes, const char *section);
+
+//=============================================================================
+
+int ValidateP3DData(FILE *file, struct P3D *p3d, struct RVHeader *rvh);
+
+//=============================================================================
+
+int ValidateP3DFaces(struct P3D *p3d, int repair);
+
+//=============================================================================
+// EXTERNING
+//=============================================================================
+
+#endif // VALIDATE_H
@@ -0,0 +1,609 @@
+//=============================================================================
+//
+//  Module:         Watch - re-convert models and maps as they are saved
+//
+//  Credits:        https://man7.org/linux/man-pages/man7/inotify.7.html
+//
+//  Author:         GameSpy
+//
+//  Date:           Started 19.10.2026
+//
+//=============================================================================
+// Every directory below the root gets an inotify watch. A burst of events is
+// collected until it settles, duplicates are dropped and only files whose
+// content really changed are converted, next to the source. Maps are hashed
+// per part, a terrain change rewrites the tiles, placement and net changes
+// are only reported, there is no export for them.
+//=============================================================================
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "watch.h"
+#include "poseidon.h"
+#include "thread.h"
+#include "terrain.h"
+#include "common.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+#define KIND_NONE 0
+#define KIND_P3D  1
+#define KIND_WVR  2
+
+static const char *PartName[WVR_PARTS] = { "terrain", "placements", "nets" };
+
+struct WatchJob
+{
+    char               *Path;
+    int                Kind;
+    int                Record;     //Index, Records can move while jobs are set up
+    int                Changed[WVR_PARTS];
+    int                failed;
+    double             ms;
+};
+
+static ConvertProc        WatchConvert;
+static char               **WatchDirs;   //Indexed by watch descriptor
+static int                capWatchDirs;
+static struct WatchRecord *Records;
+static int                nRecords, capRecords;
+static int                *RecordSlots;   //Open addressing over Records by Key, -1 = empty
+static int                capRecordSlots; //Power of two, kept above twice nRecords
+
+//=============================================================================
+
+static int GetFileKind(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+
+    if (!dot)                                                       return KIND_NONE;
+    if (strcmp(dot, ".p3d") == 0 || strcmp(dot, ".P3D") == 0)      return KIND_P3D;
+    if (strcmp(dot, ".wrp") == 0 || strcmp(dot, ".WRP") == 0 ||
+        strcmp(dot, ".wvr") == 0 || strcmp(dot, ".WVR") == 0)      return KIND_WVR;
+    return KIND_NONE;
+}
+
+//=============================================================================
+
+static char *JoinPath(const char *dir, const char *name)
+{
+    char *path = (char *)malloc(strlen(dir) + strlen(name) + 2);
+
+    if (path)
+    {
+        sprintf(path, "%s/%s", dir, name);
+    }
+    return path;
+}
+
+//=============================================================================
+
+static void AddWatchTree(int fd, const char *dir)
+{
+    DIR           *handle;
+    struct dirent *entry;
+    struct stat   st;
+    int           wd;
+
+    wd = inotify_add_watch(fd, dir, WATCH_EVENTS | IN_ONLYDIR);
+    if (wd < 0)
+    {
+        fprintf(stderr, "Alert: Error watching <%s>!\n", dir);
+        return;
+    }
+    if (wd >= capWatchDirs)
+    {
+        int  newcap = capWatchDirs ? capWatchDirs * 2 : 256;
+        char **dirs;
+
+        while (newcap <= wd) newcap *= 2;
+        dirs = (char **)realloc(WatchDirs, newcap * sizeof(char *));
+        if (!dirs)
+        {
+            fprintf(stderr, "Alert: Out of memory, <%s> is not watched!\n", dir);
+            inotify_rm_watch(fd, wd);
+            return;
+        }
+        WatchDirs = dirs;
+        memset(WatchDirs + capWatchDirs, 0, (newcap - capWatchDirs) * sizeof(char *));
+        capWatchDirs = newcap;
+    }
+    free(WatchDirs[wd]);
+    WatchDirs[wd] = CopyString(dir);
+
+    handle = opendir(dir);
+    if (!handle)
+    {
+        return;
+    }
+    while ((entry = readdir(handle)) != NULL)
+    {
+        char *path;
+
+        if (entry->d_name[0] == '.') //".", ".." and hidden folders like .git
+        {
+            continue;
+        }
+        path = JoinPath(dir, entry->d_name);
+        if (path && stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+        {
+            AddWatchTree(fd, path);
+        }
+        free(path);
+    }
+    closedir(handle);
+}
+
+//=============================================================================
+
+static int GrowRecordSlots(void)
+{
+    int newcap = capRecordSlots ? capRecordSlots * 2 : 1024;
+    int *slots = (int *)malloc(newcap * sizeof(int));
+    int i, slot;
+
+    if (!slots)
+    {
+        return 1;
+    }
+    for (i = 0; i < newcap; i++) slots[i] = -1;
+    for (i = 0; i < nRecords; i++)
+    {
+        slot = (int)(Records[i].Key & (newcap - 1));
+        while (slots[slot] >= 0) slot = (slot + 1) & (newcap - 1);
+        slots[slot] = i;
+    }
+    free(RecordSlots);
+    RecordSlots = slots;
+    capRecordSlots = newcap;
+    return 0;
+}
+
+//=============================================================================
+// Record of the path, created on first sight. -1 if out of memory.
+
+static int FindRecord(const char *path)
+{
+    Hash64 key = HashString(FNV64_OFFSET, path);
+    int    slot;
+
+    if (2 * (nRecords + 1) > capRecordSlots && GrowRecordSlots())
+    {
+        return -1;
+    }
+    for (slot = (int)(key & (capRecordSlots - 1)); RecordSlots[slot] >= 0; slot = (slot + 1) & (capRecordSlots - 1))
+    {
+        struct WatchRecord *record = &Records[RecordSlots[slot]];
+
+        if (record->Key == key && strcmp(record->Path, path) == 0)
+        {
+            return RecordSlots[slot];
+        }
+    }
+
+    if (nRecords == capRecords) //Not GrowArray, it forgets the capacity when it fails
+    {
+        int                newcap = capRecords ? capRecords * 2 : 256;
+        struct WatchRecord *records = (struct WatchRecord *)realloc(Records, newcap * sizeof(struct WatchRecord));
+
+        if (!records)
+        {
+            return -1;
+        }
+        Records = records;
+        capRecords = newcap;
+    }
+    Records[nRecords].Path = CopyString(path);
+    if (!Records[nRecords].Path)
+    {
+        return -1;
+    }
+    Records[nRecords].Key = key;
+    memset(Records[nRecords].Hash, 0, sizeof(Records[nRecords].Hash));
+    RecordSlots[slot] = nRecords;
+    return nRecords++;
+}
+
+//=============================================================================
+
+static unsigned char *LoadFile(const char *path, long *size)
+{
+    FILE          *file = fopen(path, "rb");
+    unsigned char *data;
+
+    if (!file)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    data = (unsigned char *)malloc(*size ? *size : 1);
+    if (data)
+    {
+        *size = (long)fread(data, 1, *size, file);
+    }
+    fclose(file);
+    return data;
+}
+
+//=============================================================================
+// Converts to "<name>.obj" through a temporary file, so a viewer never
+// picks up a half written model.
+
+static int ConvertToOBJ(const char *path)
+{
+    char  *output = (char *)malloc(strlen(path) + 8);
+    char  *temp = (char *)malloc(strlen(path) + 8);
+    FILE  *f_in;
+    FILE  *f_out;
+    int   result = 1;
+
+    if (!output || !temp)
+    {
+        free(output); free(temp);
+        return 1;
+    }
+    strcpy(output, path);
+    strcpy(strrchr(output, '.'), ".obj");
+    sprintf(temp, "%s.tmp", output);
+
+    f_in = fopen(path, "rb");
+    f_out = fopen(temp, "w");
+    if (f_in && f_out)
+    {
+        result = WatchConvert(f_in, 0, f_out, output);
+    }
+    if (f_in)  fclose(f_in);
+    if (f_out) fclose(f_out);
+
+    if (!result)
+    {
+        result = (rename(temp, output) != 0);
+    }
+    if (result)
+    {
+        remove(temp);
+    }
+    free(output);
+    free(temp);
+    return result;
+}
+
+//=============================================================================
+// Part boundaries follow ReadWVRTexture/ReadWVRModels: header, terrain sized
+// by Xsize/Ysize, placements up to the first record that names no model,
+// then the nets until the end of the file.
+
+static void HashWVRParts(const unsigned char *data, long size, Hash64 hash[WVR_PARTS])
+{
+    struct WVRModel model;
+    long            begin[WVR_PARTS + 1];
+    long            end;
+    int             xsize = 0, ysize = 0;
+    int             i;
+
+    if (size >= 3 * (long)sizeof(int))
+    {
+        memcpy(&xsize, data + sizeof(int), sizeof(int));
+        memcpy(&ysize, data + 2 * sizeof(int), sizeof(int));
+    }
+    if (xsize < 2 || xsize > HEIGHTMAP_MAX_SIZE || ysize < 2 || ysize > HEIGHTMAP_MAX_SIZE) //Broken header, all terrain
+    {
+        xsize = ysize = HEIGHTMAP_MAX_SIZE;
+    }
+
+    begin[WVR_PART_TERRAIN] = 3 * sizeof(int);
+    begin[WVR_PART_PLACEMENTS] = begin[WVR_PART_TERRAIN] + 2 * (long)xsize * ysize * sizeof(short) + 256 * 32;
+    for (end = begin[WVR_PART_PLACEMENTS]; end + (long)sizeof(struct WVRModel) <= size; end += sizeof(struct WVRModel))
+    {
+        memcpy(&model, data + end, sizeof(struct WVRModel)); //Records are not aligned in the buffer
+        if (!IsWVRModel(&model))
+        {
+            break;
+        }
+    }
+    begin[WVR_PART_NETS] = end;
+    begin[WVR_PARTS] = size;
+
+    for (i = 0; i < WVR_PARTS; i++)
+    {
+        long from = (begin[i] < size) ? begin[i] : size;
+        long to = (begin[i + 1] < size) ? begin[i + 1] : size;
+
+        hash[i] = HashBytes(FNV64_OFFSET, data + from, to - from);
+    }
+}
+
+//=============================================================================
+
+static int ExportWVRParts(struct WatchJob *job)
+{
+    int i;
+    int result = 0;
+
+    for (i = 0; i < WVR_PARTS; i++)
+    {
+        if (job->Changed[i])
+        {
+            printf("Info: <%s> %s changed\n", job->Path, PartName[i]);
+        }
+    }
+
+    if (job->Changed[WVR_PART_TERRAIN]) //Tiles next to the map, "<name>_<x>_<y>_lod<n>.obj"
+    {
+        struct RVHeader rvh;
+        struct WVR      *wvr = (struct WVR *)malloc(sizeof(struct WVR));
+        char            *prefix = CopyString(job->Path);
+        FILE            *file = fopen(job->Path, "rb");
+
+        result = 1;
+        if (wvr && prefix && file &&
+            fread(&rvh.Signature, sizeof(int), 1, file) == 1 &&
+            fread(&rvh.Unknown, sizeof(int), 1, file) == 1 &&
+            fread(&rvh.Unknown1, sizeof(int), 1, file) == 1)
+        {
+            *strrchr(prefix, '.') = '\0';
+            wvr->texture.Elevations = NULL;
+            wvr->texture.TextureIndex = NULL;
+            result = ReadWVRTexture(file, wvr, &rvh);
+            if (!result)
+            {
+                result = ExportWVRTerrain(wvr, prefix, 0); //No -textures here, nothing would decode the images
+            }
+            free(wvr->texture.Elevations);
+            free(wvr->texture.TextureIndex);
+        }
+        if (file) fclose(file);
+        free(prefix);
+        free(wvr);
+    }
+    return result;
+}
+
+//=============================================================================
+
+static void RunWatchJob(void *context, int index)
+{
+    struct WatchJob *job = &((struct WatchJob *)context)[index];
+    Hash64          hash[WVR_PARTS];
+    unsigned char   *data;
+    long            size = 0;
+    double          start = GetTimeMs();
+    int             i;
+    int             any = 0;
+
+    data = LoadFile(job->Path, &size);
+    if (!data) //Deleted or renamed again before we got to it
+    {
+        return;
+    }
+
+    memset(hash, 0, sizeof(hash));
+    if (job->Kind == KIND_WVR)
+    {
+        HashWVRParts(data, size, hash);
+    }
+    else
+    {
+        hash[0] = HashBytes(FNV64_OFFSET, data, size);
+    }
+    free(data);
+
+    for (i = 0; i < WVR_PARTS; i++)
+    {
+        job->Changed[i] = (hash[i] != Records[job->Record].Hash[i]);
+        any |= job->Changed[i];
+    }
+    if (!any) //Saved without changes
+    {
+        return;
+    }
+
+    if (job->Kind == KIND_WVR)
+    {
+        job->failed = ExportWVRParts(job);
+    }
+    else
+    {
+        job->failed = ConvertToOBJ(job->Path);
+    }
+    if (!job->failed) //A failed file is tried again on its next save, even if unchanged
+    {
+        memcpy(Records[job->Record].Hash, hash, sizeof(hash));
+    }
+    job->ms = GetTimeMs() - start;
+}
+
+//=============================================================================
+
+static int ComparePaths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+//=============================================================================
+
+static void FlushPending(char **pending, int nPending)
+{
+    struct WatchJob *job;
+    int             nJobs = 0;
+    int             i;
+
+    qsort(pending, nPending, sizeof(char *), ComparePaths);
+
+    job = (struct WatchJob *)calloc(nPending ? nPending : 1, sizeof(struct WatchJob));
+    if (!job)
+    {
+        return;
+    }
+    for (i = 0; i < nPending; i++)
+    {
+        if (i > 0 && strcmp(pending[i], pending[i - 1]) == 0)
+        {
+            continue;
+        }
+        job[nJobs].Path = pending[i];
+        job[nJobs].Kind = GetFileKind(pending[i]);
+        job[nJobs].Record = FindRecord(pending[i]); //Not thread safe, so before the fan out
+        if (job[nJobs].Record < 0)
+        {
+            fprintf(stderr, "Alert: Out of memory, <%s> skipped!\n", pending[i]);
+            continue;
+        }
+        nJobs++;
+    }
+
+    ParallelFor(nJobs, RunWatchJob, job);
+
+    for (i = 0; i < nJobs; i++)
+    {
+        if (job[i].failed)
+        {
+            fprintf(stderr, "Alert: Error converting <%s>!\n", job[i].Path);
+        }
+        else if (job[i].ms > 0.0)
+        {
+            printf("Info: <%s> updated in %.1f ms\n", job[i].Path, job[i].ms);
+        }
+    }
+    fflush(stdout);
+    free(job);
+}
+
+//=============================================================================
+
+static void ReadEvents(int fd, char ***pending, int *nPending, int *capPending)
+{
+    union
+    {
+        struct inotify_event event; //Alignment
+        char                 bytes[65536];
+    } buffer;
+    char    *p;
+    ssize_t length;
+
+    length = read(fd, buffer.bytes, sizeof(buffer.bytes));
+    for (p = buffer.bytes; length > 0 && p < buffer.bytes + length; )
+    {
+        struct inotify_event *event = (struct inotify_event *)p;
+        const char           *dir = (event->wd >= 0 && event->wd < capWatchDirs) ? WatchDirs[event->wd] : NULL;
+
+        p += sizeof(struct inotify_event) + event->len;
+
+        if (event->mask & IN_Q_OVERFLOW)
+        {
+            fprintf(stderr, "Alert: Too many changes at once, some were missed!\n");
+            continue;
+        }
+        if (!dir || event->len == 0)
+        {
+            continue;
+        }
+
+        if (event->mask & IN_ISDIR)
+        {
+            if (event->name[0] != '.')
+            {
+                char *path = JoinPath(dir, event->name);
+                if (path) AddWatchTree(fd, path);
+                free(path);
+            }
+        }
+        else if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) && GetFileKind(event->name) != KIND_NONE)
+        {
+            char *path = JoinPath(dir, event->name);
+
+            if (path && *nPending == *capPending)
+            {
+                int  newcap = *capPending ? *capPending * 2 : 256;
+                char **list = (char **)realloc(*pending, newcap * sizeof(char *));
+
+                if (list)
+                {
+                    *pending = list;
+                    *capPending = newcap;
+                }
+            }
+            if (!path || *nPending == *capPending)
+            {
+                fprintf(stderr, "Alert: Out of memory, <%s/%s> skipped!\n", dir, event->name);
+                free(path);
+                continue;
+            }
+            (*pending)[(*nPending)++] = path;
+        }
+    }
+}
+
+//=============================================================================
+
+int RunWatch(const char *root, ConvertProc convert)
+{
+    struct pollfd pfd;
+    char          **pending = NULL;
+    int           nPending = 0;
+    int           capPending = 0;
+    int           fd;
+    int           i;
+
+    WatchConvert = convert;
+
+    fd = inotify_init();
+    if (fd < 0)
+    {
+        fprintf(stderr, "Alert: Error starting inotify!\n");
+        return 1;
+    }
+    AddWatchTree(fd, root);
+    printf("Info: Watching <%s>\n", root);
+    fflush(stdout);
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    while (1)
+    {
+        double deadline;
+
+        ReadEvents(fd, &pending, &nPending, &capPending); //Blocks until something happens
+        deadline = GetTimeMs() + WATCH_MAX_MS;
+
+        while (GetTimeMs() < deadline && poll(&pfd, 1, WATCH_SETTLE_MS) > 0)
+        {
+            ReadEvents(fd, &pending, &nPending, &capPending);
+        }
+
+        if (nPending)
+        {
+            FlushPending(pending, nPending);
+            for (i = 0; i < nPending; i++)
+            {
+                free(pending[i]);
+            }
+            nPending = 0;
+        }
+    }
+    return 0;
+}
+
+#else
+
+//=============================================================================
+
+int RunWatch(const char *root, ConvertProc convert)
+{
+    fprintf(stderr, "Alert: Watch mode needs inotify (Linux)!\n");
+    return 1;
+}
+
+#endif
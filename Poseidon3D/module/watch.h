@@ -0,0 +1,37 @@
+#ifndef WATCH_H
+#define WATCH_H
+#include "daemon.h"
+#include "common.h"
+
+//=============================================================================
+// DATA SIGNS
+//=============================================================================
+
+#define WATCH_SETTLE_MS 150 //Quiet time that ends a burst of events
+#define WATCH_MAX_MS    500 //Hard cap, a constant stream of saves still gets converted
+
+#define WVR_PART_TERRAIN    0 //Elevations, TextureIndex, TextureName
+#define WVR_PART_PLACEMENTS 1 //WVRModel table
+#define WVR_PART_NETS       2 //Everything after the models
+#define WVR_PARTS           3
+
+//=============================================================================
+// PROTOTYPING
+//=============================================================================
+
+int RunWatch(const char *root, ConvertProc convert);
+
+//=============================================================================
+// EXTERNING
+//=============================================================================
+
+//=============================================================================
+
+struct WatchRecord
+{
+    char          *Path;
+    Hash64        Key;             //HashString of Path
+    Hash64        Hash[WVR_PARTS]; //P3D files only use the first one
+};
+
+#endif // WATCH_H
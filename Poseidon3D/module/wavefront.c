@@ -0,0 +1,615 @@
+//=============================================================================
+//
+//  Module:         OBJ reader - Wavefront text models back into P3D
+//
+//  Credits:        https://paulbourke.net/dataformats/obj/
+//
+//  Author:         GameSpy
+//
+//  Date:           Started 19.10.2026
+//
+//=============================================================================
+// The file is loaded in one piece, cut into chunks on line boundaries and
+// every chunk is parsed on its own thread. Negative (relative) indices and
+// "usemtl" state crossing a chunk boundary are resolved in the merge pass.
+//=============================================================================
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "wavefront.h"
+#include "thread.h"
+#include "common.h"
+
+#define LOCAL_POINT  0x01
+#define LOCAL_UV     0x02
+#define LOCAL_NORMAL 0x04
+
+static const double Power10[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+//=============================================================================
+
+static const char *SkipBlanks(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+//=============================================================================
+
+static const char *SkipLine(const char *p, const char *end)
+{
+    while (p < end && *p != '\n') p++;
+    return (p < end) ? p + 1 : end;
+}
+
+//=============================================================================
+// Hand rolled from_chars: no locale, no allocation, exact for up to 15 digits.
+// Anything longer goes through strtod, which is correct but slow.
+
+static const char *ParseFloat(const char *p, const char *end, float *out)
+{
+    const char *start;
+    double value = 0.0;
+    int    negative = 0;
+    int    digits = 0;
+    int    exponent = 0;
+
+    p = SkipBlanks(p, end);
+    start = p;
+
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        value = value * 10.0 + (*p++ - '0');
+        digits++;
+    }
+    if (p < end && *p == '.')
+    {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            value = value * 10.0 + (*p++ - '0');
+            exponent--;
+            digits++;
+        }
+    }
+    if (digits == 0)
+    {
+        return NULL;
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        int expnegative = 0;
+        int expvalue = 0;
+
+        p++;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            expnegative = (*p == '-');
+            p++;
+        }
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            if (expvalue < 10000) expvalue = expvalue * 10 + (*p - '0');
+            p++;
+        }
+        exponent += expnegative ? -expvalue : expvalue;
+    }
+
+    if (digits > 15) //Slow path, the mantissa no longer fits a double exactly
+    {
+        char  buffer[64];
+        int   length = (int)(p - start);
+
+        if (length >= (int)sizeof(buffer)) length = sizeof(buffer) - 1;
+        memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        *out = (float)strtod(buffer, NULL);
+        return p;
+    }
+
+    if (exponent < 0)
+    {
+        value = (exponent >= -22) ? value / Power10[-exponent] : value * pow(10.0, exponent);
+    }
+    else if (exponent > 0)
+    {
+        value = (exponent <= 22) ? value * Power10[exponent] : value * pow(10.0, exponent);
+    }
+
+    *out = (float)(negative ? -value : value);
+    return p;
+}
+
+//=============================================================================
+
+static const char *ParseInt(const char *p, const char *end, int *out)
+{
+    int value = 0;
+    int negative = 0;
+    int digits = 0;
+
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        if (value > (INT_MAX - (*p - '0')) / 10) //No index gets that far, the face is broken
+        {
+            return NULL;
+        }
+        value = value * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (digits == 0)
+    {
+        return NULL;
+    }
+    *out = negative ? -value : value;
+    return p;
+}
+
+//=============================================================================
+// OBJ indices are 1-based, negative ones count back from the current end.
+// Those are stored chunk relative and fixed up once the chunk bases are known.
+
+static int ResolveIndex(int index, int count, int *resolved)
+{
+    if (index > 0)
+    {
+        *resolved = index - 1;
+        return 0;
+    }
+    *resolved = count + index;
+    return 1;
+}
+
+//=============================================================================
+
+static const char *ParseFace(struct OBJChunk *chunk, const char *p, const char *end)
+{
+    struct OBJFace   *face;
+    struct OBJCorner *corner;
+    int              value;
+
+    chunk->face = (struct OBJFace *)GrowArray(chunk->face, &chunk->capFaces, chunk->nFaces + 1, sizeof(struct OBJFace));
+    if (!chunk->face)
+    {
+        chunk->failed = 1;
+        return end;
+    }
+    face = &chunk->face[chunk->nFaces];
+    face->FirstCorner = chunk->nCorners;
+    face->nCorners = 0;
+    face->Material = chunk->nMaterials - 1;
+
+    while (1)
+    {
+        p = SkipBlanks(p, end);
+        if (p >= end || *p == '\n' || *p == '\r' || *p == '#')
+        {
+            break;
+        }
+
+        chunk->corner = (struct OBJCorner *)GrowArray(chunk->corner, &chunk->capCorners, chunk->nCorners + 1, sizeof(struct OBJCorner));
+        if (!chunk->corner)
+        {
+            chunk->failed = 1;
+            return end;
+        }
+        corner = &chunk->corner[chunk->nCorners];
+        corner->UVIndex = -1;
+        corner->NormalsIndex = -1;
+        corner->Local = 0;
+
+        p = ParseInt(p, end, &value);
+        if (!p || value == 0)
+        {
+            chunk->failed = 1;
+            return end;
+        }
+        if (ResolveIndex(value, chunk->nPoints, &corner->PointsIndex)) corner->Local |= LOCAL_POINT;
+
+        if (p < end && *p == '/')
+        {
+            p++;
+            if (p < end && *p != '/')
+            {
+                p = ParseInt(p, end, &value);
+                if (!p || value == 0)
+                {
+                    chunk->failed = 1;
+                    return end;
+                }
+                if (ResolveIndex(value, chunk->nUVs, &corner->UVIndex)) corner->Local |= LOCAL_UV;
+            }
+            if (p < end && *p == '/')
+            {
+                p++;
+                p = ParseInt(p, end, &value);
+                if (!p || value == 0)
+                {
+                    chunk->failed = 1;
+                    return end;
+                }
+                if (ResolveIndex(value, chunk->nNormals, &corner->NormalsIndex)) corner->Local |= LOCAL_NORMAL;
+            }
+        }
+
+        chunk->nCorners++;
+        face->nCorners++;
+    }
+
+    if (face->nCorners >= 3) //Points and lines have no place in a P3D
+    {
+        chunk->nFaces++;
+    }
+    else
+    {
+        chunk->nCorners = face->FirstCorner;
+    }
+    return p;
+}
+
+//=============================================================================
+
+static const char *ParseTriplet(struct OBJChunk *chunk, const char *p, const char *end, struct P3DTriplet **array, int *count, int *capacity)
+{
+    struct P3DTriplet *triplet;
+
+    *array = (struct P3DTriplet *)GrowArray(*array, capacity, *count + 1, sizeof(struct P3DTriplet));
+    if (!*array)
+    {
+        chunk->failed = 1;
+        return end;
+    }
+    triplet = &(*array)[*count];
+
+    if (!(p = ParseFloat(p, end, &triplet->XYZ[0])) ||
+        !(p = ParseFloat(p, end, &triplet->XYZ[1])) ||
+        !(p = ParseFloat(p, end, &triplet->XYZ[2])))
+    {
+        chunk->failed = 1;
+        return end;
+    }
+    (*count)++;
+    return p;
+}
+
+//=============================================================================
+
+static const char *ParseTexCoord(struct OBJChunk *chunk, const char *p, const char *end)
+{
+    struct OBJTexCoord *uv;
+
+    chunk->uv = (struct OBJTexCoord *)GrowArray(chunk->uv, &chunk->capUVs, chunk->nUVs + 1, sizeof(struct OBJTexCoord));
+    if (!chunk->uv)
+    {
+        chunk->failed = 1;
+        return end;
+    }
+    uv = &chunk->uv[chunk->nUVs];
+
+    if (!(p = ParseFloat(p, end, &uv->U)))
+    {
+        chunk->failed = 1;
+        return end;
+    }
+    if (!ParseFloat(p, end, &uv->V)) //"vt u" is legal, v defaults to 0
+    {
+        uv->V = 0.0f;
+    }
+    chunk->nUVs++;
+    return p;
+}
+
+//=============================================================================
+
+static const char *ParseMaterial(struct OBJChunk *chunk, const char *p, const char *end)
+{
+    char *name;
+    int  length = 0;
+
+    chunk->material = (char (*)[32])GrowArray(chunk->material, &chunk->capMaterials, chunk->nMaterials + 1, 32);
+    if (!chunk->material)
+    {
+        chunk->failed = 1;
+        return end;
+    }
+    name = chunk->material[chunk->nMaterials++];
+
+    p = SkipBlanks(p, end);
+    while (p < end && *p != '\n' && *p != '\r')
+    {
+        if (length < 31) name[length++] = *p; //Same limit as P3DLodFace.TextureName
+        p++;
+    }
+    while (length > 0 && (name[length - 1] == ' ' || name[length - 1] == '\t')) length--;
+    name[length] = '\0';
+    return p;
+}
+
+//=============================================================================
+
+static void ParseOBJChunk(void *context, int index)
+{
+    struct OBJChunk *chunk = &((struct OBJChunk *)context)[index];
+    const char      *p = chunk->begin;
+    const char      *end = chunk->end;
+
+    while (p < end && !chunk->failed)
+    {
+        p = SkipBlanks(p, end);
+        if (p >= end)
+        {
+            break;
+        }
+
+        if (p[0] == 'v' && p + 1 < end && (p[1] == ' ' || p[1] == '\t'))
+        {
+            p = ParseTriplet(chunk, p + 1, end, &chunk->point, &chunk->nPoints, &chunk->capPoints);
+        }
+        else if (p[0] == 'v' && p + 2 < end && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+        {
+            p = ParseTriplet(chunk, p + 2, end, &chunk->normal, &chunk->nNormals, &chunk->capNormals);
+        }
+        else if (p[0] == 'v' && p + 2 < end && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+        {
+            p = ParseTexCoord(chunk, p + 2, end);
+        }
+        else if (p[0] == 'f' && p + 1 < end && (p[1] == ' ' || p[1] == '\t'))
+        {
+            p = ParseFace(chunk, p + 1, end);
+        }
+        else if (end - p > 6 && strncmp(p, "usemtl", 6) == 0 && (p[6] == ' ' || p[6] == '\t'))
+        {
+            p = ParseMaterial(chunk, p + 6, end);
+        }
+        p = SkipLine(p, end); //Comments, groups, smoothing and everything else we don't need
+    }
+}
+
+//=============================================================================
+
+struct OBJMerge
+{
+    struct OBJChunk *chunk;
+    struct P3D      *p3d;
+    int             *baseFaces;
+    const char      **inherited; //"usemtl" in effect when the chunk starts
+    struct OBJTexCoord *uv;      //UVs of every chunk, faces may reference any of them
+    int             nUVs;
+    int             failed;
+};
+
+//=============================================================================
+
+static void EmitOBJChunk(void *context, int index)
+{
+    struct OBJMerge   *merge = (struct OBJMerge *)context;
+    struct OBJChunk   *chunk = &merge->chunk[index];
+    struct P3D        *p3d = merge->p3d;
+    struct P3DLodFace *lodface = &p3d->lodface[merge->baseFaces[index]];
+    int               i,j,k;
+
+    for (i = 0; i < chunk->nPoints; i++)
+    {
+        p3d->point[chunk->basePoints + i].position = chunk->point[i];
+        p3d->point[chunk->basePoints + i].PointFlags = 0;
+    }
+    if (chunk->nNormals)
+    {
+        memcpy(&p3d->triplet[chunk->baseNormals], chunk->normal, chunk->nNormals * sizeof(struct P3DTriplet));
+    }
+
+    for (i = 0; i < chunk->nFaces; i++)
+    {
+        struct OBJFace   *face = &chunk->face[i];
+        struct OBJCorner corner[4];
+        const char       *texture = (face->Material >= 0) ? chunk->material[face->Material] : merge->inherited[index];
+        int              nPolygons = (face->nCorners == 4) ? 1 : face->nCorners - 2;
+
+        for (k = 0; k < nPolygons; k++) //Anything above a quad becomes a triangle fan
+        {
+            int fan[4];
+            int nFan = (face->nCorners == 4) ? 4 : 3;
+
+            fan[0] = 0; fan[1] = k + 1; fan[2] = k + 2; fan[3] = 3;
+
+            memset(lodface, 0, sizeof(struct P3DLodFace));
+            strncpy(lodface->TextureName, texture, sizeof(lodface->TextureName) - 1);
+            lodface->FaceType = nFan;
+
+            for (j = 0; j < nFan; j++)
+            {
+                corner[j] = chunk->corner[face->FirstCorner + fan[j]];
+                if (corner[j].Local & LOCAL_POINT)  corner[j].PointsIndex += chunk->basePoints;
+                if (corner[j].Local & LOCAL_UV)     corner[j].UVIndex += chunk->baseUVs;
+                if (corner[j].Local & LOCAL_NORMAL) corner[j].NormalsIndex += chunk->baseNormals;
+
+                if (corner[j].PointsIndex < 0 || corner[j].PointsIndex >= p3d->data.nPoints ||
+                    corner[j].UVIndex >= merge->nUVs || ((corner[j].Local & LOCAL_UV) && corner[j].UVIndex < 0) ||
+                    corner[j].NormalsIndex >= p3d->data.nFaceNormals || ((corner[j].Local & LOCAL_NORMAL) && corner[j].NormalsIndex < 0))
+                {
+                    merge->failed = 1;
+                    return;
+                }
+
+                lodface->p3dvertextable[j].PointsIndex = corner[j].PointsIndex;
+                lodface->p3dvertextable[j].NormalsIndex = (corner[j].NormalsIndex >= 0) ? corner[j].NormalsIndex : 0;
+                if (corner[j].UVIndex >= 0)
+                {
+                    lodface->p3dvertextable[j].U = merge->uv[corner[j].UVIndex].U;
+                    lodface->p3dvertextable[j].V = merge->uv[corner[j].UVIndex].V;
+                }
+            }
+            lodface++;
+        }
+    }
+}
+
+//=============================================================================
+
+int ReadOBJFile(FILE *file, struct P3D *p3d)
+{
+    char            *buffer;
+    long            size;
+    int             i;
+    int             nChunks;
+    int             nFaces = 0;
+    int             nUVs = 0;
+    int             result = 1;
+    struct OBJChunk *chunk;
+    struct OBJMerge merge;
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < 0)
+    {
+        fprintf(stderr, "Alert: Error reading OBJ file size!\n");
+        return 1;
+    }
+
+    buffer = (char *)malloc(size + 1);
+    if (!buffer)
+    {
+        fprintf(stderr, "Alert: Not enough memory for OBJ file!\n");
+        return 1;
+    }
+    size = (long)fread(buffer, 1, size, file);
+    buffer[size] = '\0';
+
+    nChunks = GetThreadCount() * OBJ_CHUNKS_PER_THREAD;
+    if (size / nChunks < OBJ_MIN_CHUNK_SIZE) nChunks = (int)(size / OBJ_MIN_CHUNK_SIZE) + 1;
+
+    chunk = (struct OBJChunk *)calloc(nChunks, sizeof(struct OBJChunk));
+    merge.baseFaces = (int *)malloc(nChunks * sizeof(int));
+    merge.inherited = (const char **)malloc(nChunks * sizeof(const char *));
+    merge.uv = NULL;
+    if (!chunk || !merge.baseFaces || !merge.inherited)
+    {
+        fprintf(stderr, "Alert: Not enough memory for OBJ file!\n");
+        free(chunk); free(merge.baseFaces); free(merge.inherited); free(buffer);
+        return 1;
+    }
+
+    for (i = 0; i < nChunks; i++) //Cut on line boundaries only
+    {
+        chunk[i].begin = (i == 0) ? buffer : chunk[i - 1].end;
+        if (i == nChunks - 1)
+        {
+            chunk[i].end = buffer + size;
+        }
+        else
+        {
+            chunk[i].end = buffer + (long)(((double)size * (i + 1)) / nChunks);
+            if (chunk[i].end < chunk[i].begin) chunk[i].end = chunk[i].begin;
+            chunk[i].end = SkipLine(chunk[i].end, buffer + size);
+        }
+    }
+
+    ParallelFor(nChunks, ParseOBJChunk, chunk);
+
+    p3d->data.nPoints = 0;
+    p3d->data.nFaceNormals = 0;
+    for (i = 0; i < nChunks; i++)
+    {
+        if (chunk[i].failed)
+        {
+            fprintf(stderr, "Alert: Broken OBJ data in chunk %d!\n", i);
+            goto cleanup;
+        }
+        chunk[i].basePoints = p3d->data.nPoints;
+        chunk[i].baseNormals = p3d->data.nFaceNormals;
+        chunk[i].baseUVs = nUVs;
+        merge.baseFaces[i] = nFaces;
+        merge.inherited[i] = (i == 0) ? "" : (chunk[i - 1].nMaterials ? chunk[i - 1].material[chunk[i - 1].nMaterials - 1] : merge.inherited[i - 1]);
+
+        p3d->data.nPoints += chunk[i].nPoints;
+        p3d->data.nFaceNormals += chunk[i].nNormals;
+        nUVs += chunk[i].nUVs;
+        {
+            int j;
+            for (j = 0; j < chunk[i].nFaces; j++)
+            {
+                nFaces += (chunk[i].face[j].nCorners == 4) ? 1 : chunk[i].face[j].nCorners - 2;
+            }
+        }
+    }
+    p3d->data.nFaces = nFaces;
+
+    p3d->point = (struct P3DPoint *)malloc((p3d->data.nPoints ? p3d->data.nPoints : 1) * sizeof(struct P3DPoint));
+    p3d->triplet = (struct P3DTriplet *)calloc(p3d->data.nFaceNormals ? p3d->data.nFaceNormals : 1, sizeof(struct P3DTriplet));
+    p3d->lodface = (struct P3DLodFace *)malloc((nFaces ? nFaces : 1) * sizeof(struct P3DLodFace));
+    merge.uv = (struct OBJTexCoord *)malloc((nUVs ? nUVs : 1) * sizeof(struct OBJTexCoord));
+    if (!p3d->point || !p3d->triplet || !p3d->lodface || !merge.uv)
+    {
+        fprintf(stderr, "Alert: Not enough memory for OBJ file!\n");
+        goto cleanup;
+    }
+    for (i = 0; i < nChunks; i++)
+    {
+        if (chunk[i].nUVs) memcpy(&merge.uv[chunk[i].baseUVs], chunk[i].uv, chunk[i].nUVs * sizeof(struct OBJTexCoord));
+    }
+
+    merge.chunk = chunk;
+    merge.p3d = p3d;
+    merge.nUVs = nUVs;
+    merge.failed = 0;
+    if (p3d->data.nFaceNormals == 0) //NormalsIndex has to point somewhere
+    {
+        p3d->data.nFaceNormals = 1;
+    }
+    ParallelFor(nChunks, EmitOBJChunk, &merge);
+
+    if (merge.failed)
+    {
+        fprintf(stderr, "Alert: OBJ face index out of range!\n");
+        goto cleanup;
+    }
+
+    p3d->supply.Signature = SS3D_SIGNATURE;
+    p3d->supply.nPoints = p3d->data.nPoints;
+    p3d->supply.nFaces = p3d->data.nFaces;
+    p3d->supply.nNormals = p3d->data.nFaceNormals;
+    p3d->supply.nBytes = 0;
+
+    #ifdef _DEBUG
+    printf("Debug: OBJ chunks: %d\n",  nChunks);
+    printf("Debug: nPoints: %d\n",     p3d->data.nPoints);
+    printf("Debug: nNormals: %d\n",    p3d->data.nFaceNormals);
+    printf("Debug: nFaces: %d\n",      p3d->data.nFaces);
+    #endif
+    result = 0;
+
+cleanup:
+    for (i = 0; i < nChunks; i++)
+    {
+        free(chunk[i].point);
+        free(chunk[i].normal);
+        free(chunk[i].uv);
+        free(chunk[i].corner);
+        free(chunk[i].face);
+        free(chunk[i].material);
+    }
+    free(chunk);
+    free(merge.baseFaces);
+    free(merge.inherited);
+    free(merge.uv);
+    free(buffer);
+    return result;
+}
@@ -0,0 +1,70 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+#include "poseidon.h"
+
+//=============================================================================
+// DATA SIGNS
+//=============================================================================
+
+#define OBJ_CHUNKS_PER_THREAD 4     //More chunks than threads, so a slow chunk doesn't stall the rest
+#define OBJ_MIN_CHUNK_SIZE    65536 //Don't bother splitting tiny files
+
+//=============================================================================
+// PROTOTYPING
+//=============================================================================
+
+int ReadOBJFile(FILE *file, struct P3D *p3d);
+
+//=============================================================================
+// EXTERNING
+//=============================================================================
+
+//=============================================================================
+// OBJ - Wavefront text format (parsing state)
+//=============================================================================
+
+struct OBJTexCoord
+{
+    float U,V;
+};
+
+//=============================================================================
+
+struct OBJCorner
+{
+    int  PointsIndex;  //0-based, -1 if absent
+    int  UVIndex;      //0-based, -1 if absent
+    int  NormalsIndex; //0-based, -1 if absent
+    char Local;        //Bitmask of indices which are relative to the chunk (negative OBJ indices)
+};
+
+//=============================================================================
+
+struct OBJFace
+{
+    int FirstCorner;
+    int nCorners;
+    int Material;      //Index into the chunk material table, -1 inherits the previous "usemtl"
+};
+
+//=============================================================================
+
+struct OBJChunk
+{
+    const char         *begin;
+    const char         *end;
+
+    struct P3DTriplet  *point;   int nPoints,   capPoints;
+    struct P3DTriplet  *normal;  int nNormals,  capNormals;
+    struct OBJTexCoord *uv;      int nUVs,      capUVs;
+    struct OBJCorner   *corner;  int nCorners,  capCorners;
+    struct OBJFace     *face;    int nFaces,    capFaces;
+    char               (*material)[32]; int nMaterials, capMaterials;
+
+    int                basePoints;  //Filled in after every chunk is parsed
+    int                baseNormals;
+    int                baseUVs;
+    int                failed;
+};
+
+#endif // WAVEFRONT_H